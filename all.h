@@ -5,6 +5,7 @@
 #include "violet/core.h"
 /* Data structures */
 #include "violet/array.h"
+#include "violet/hashmap.h"
 #include "violet/list.h"
 /* Math */
 #include "violet/dmath.h"
@@ -89,6 +90,7 @@ v2d v2i_to_v2d(v2i v)
 #define FMATH_IMPLEMENTATION
 #define GEOM_IMPLEMENTATION
 #define GUI_IMPLEMENTATION
+#define HASHMAP_IMPLEMENTATION
 #define IMATH_IMPLEMENTATION
 #define IMG_STUB_IMPLEMENTATION
 #define LIST_IMPLEMENTATION
@@ -109,6 +111,7 @@ v2d v2i_to_v2d(v2i v)
 #include "violet/core.h"
 /* Data structures */
 #include "violet/array.h"
+#include "violet/hashmap.h"
 #include "violet/list.h"
 /* Math */
 #include "violet/dmath.h"
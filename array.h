@@ -19,7 +19,32 @@ typedef struct array__head
 	allocator_t *allocator;
 } array__head;
 
+/* set in cap while the array lives in storage it does not own */
+#define ARRAY__INLINE ((array_size_t)1 << 31)
+/* set in cap while the array lives in pages mapped by array.h */
+#define ARRAY__MAPPED ((array_size_t)1 << 30)
+#define ARRAY__FLAGS  (ARRAY__INLINE | ARRAY__MAPPED)
+/* The flags leave arrays room for at most 2^30 - 1 elements; asking for more
+ * is fatal */
+#define ARRAY_MAX_CAP (ARRAY__MAPPED - 1)
+
+/* Arrays on the default heap allocator that grow past this many bytes move
+ * into their own mapping, which mremap can grow without copying. */
+#if defined(__linux__) && !defined(ARRAY_NO_MREMAP)
+#define ARRAY__MREMAP
+#ifndef ARRAY_MREMAP_THRESHOLD
+#define ARRAY_MREMAP_THRESHOLD (4 * 1024 * 1024)
+#endif
+#endif
+
 #define array(type) type*
+
+/* Storage for up to n elements, as a struct member or local variable.
+ * An array initialized with array_init_inline uses it until it outgrows it,
+ * then moves to the allocator.  One initialized with array_init_fixed has no
+ * allocator & cannot grow past n.  array_destroy must still be called, but
+ * only frees spilled arrays.  The storage must not be moved while in use. */
+#define array_storage(type, n)     struct { array__head head; type buf[n]; }
 #define ENFORCE_ARRAY_OF_ARRAY(a)  ((void)(**(a)), (array(array(void)))(a))
 
 #define array__get_head(a)         (((array__head*)(a)) - 1)
@@ -29,11 +54,17 @@ typedef struct array__head
 #define array_init(a, cap)         array_init_ex(a, cap, g_allocator)
 #define array_init_ex(a, cap, alc) (a)=array__create(cap, sizeof(*a), alc \
                                                      MEMCALL_LOCATION)
-#define array_destroy(a)           afree(array__get_head(a), array__allocator(a))
+#define array_init_inline(a, storage, alc) \
+                                   ((a)=array__init_inline((storage).buf, \
+                                                           countof((storage).buf), alc))
+#define array_init_fixed(a, storage) \
+                                   array_init_inline(a, storage, NULL)
+#define array_destroy(a)           array__destroy(a  MEMCALL_LOCATION)
 
 #define array__esz(a)              (sizeof(*(a)))
 #define array_sz(a)                (array__get_head(a)->sz)
-#define array_cap(a)               (array__get_head(a)->cap)
+#define array_cap(a)               (array__get_head(a)->cap & ~ARRAY__FLAGS)
+#define array_is_inline(a)         ((array__get_head(a)->cap & ARRAY__INLINE) != 0)
 #define array_empty(a)             (array_sz(a) == 0)
 
 #define array_copy(dst, src)       ((dst)=array__copy(dst, src, array__esz(src) \
@@ -67,14 +98,24 @@ typedef struct array__head
                                                            MEMCALL_LOCATION), \
                                     (a)+(i))
 #define array_insert(a, i, e)      (*array_insert_null(a, i) = e)
+#define array_insert_null_n(a, i, n) ((a)=array__insert_n(a, i, NULL, n, array__esz(a) \
+                                                          MEMCALL_LOCATION), \
+                                      (a)+(i))
+#define array_insert_n(a, i, p, n) (assert((a) != (p)), \
+                                    (a)=array__insert_n(a, i, p, n, array__esz(a) \
+                                                        MEMCALL_LOCATION))
 #define array_insert_fast(a, i, e) ((a)=array__append_null(a, array__esz(a) \
                                                            MEMCALL_LOCATION), \
                                     array_last(a) = (a)[(i)], (a)[(i)] = (e))
 #define array_remove(a, i)         array_remove_n(a, i, 1)
 #define array_remove_n(a, i, n)    array__remove(a, i, n, array__esz(a))
+/* removes [beg, end) */
+#define array_remove_range(a, beg, end) array_remove_n(a, beg, (end) - (beg))
 #define array_remove_fast(a, i)    array__remove_fast(a, i, array__esz(a))
 #define array_pop(a)               (--array_sz(a))
 #define array_clear(a)             (array_sz(a) = 0)
+#define array_shrink(a)            ((a)=array__shrink(a, array__esz(a) \
+                                                      MEMCALL_LOCATION))
 
 #define array_reverse(a)           reverse(a, array__esz(a), array_sz(a))
 #define array_qsort(a, cmp)        qsort(a, array_sz(a), array__esz(a), cmp)
@@ -99,6 +140,8 @@ typedef struct array__head
 
 ARRDEF void *array__create(array_size_t cap, size_t sz, allocator_t *a
                            MEMCALL_ARGS);
+ARRDEF void *array__init_inline(void *buf, array_size_t cap, allocator_t *a);
+ARRDEF void  array__destroy(void *a  MEMCALL_ARGS);
 ARRDEF void *array__reserve(void *a, array_size_t nmemb, size_t sz
                             MEMCALL_ARGS);
 ARRDEF void *array__copy(void *dst, const void *src, size_t sz  MEMCALL_ARGS);
@@ -108,6 +151,9 @@ ARRDEF void *array__appendn(void *a, const void *p, array_size_t n, size_t sz
                             MEMCALL_ARGS);
 ARRDEF void *array__insert_null(void *a, array_size_t idx, size_t sz
                                 MEMCALL_ARGS);
+ARRDEF void *array__insert_n(void *a, array_size_t idx, const void *p,
+                             array_size_t n, size_t sz  MEMCALL_ARGS);
+ARRDEF void *array__shrink(void *a, size_t sz  MEMCALL_ARGS);
 ARRDEF void array__remove(void *a, array_size_t idx, array_size_t n, size_t sz);
 ARRDEF void array__remove_fast(void *a, array_size_t idx, size_t sz);
 ARRDEF void *array__find(void *a, const void *userp, size_t sz,
@@ -125,12 +171,104 @@ ARRDEF void *array__array_copy(array(array(void)) dst, array(array(void)) src,
 
 #ifdef ARRAY_IMPLEMENTATION
 
+#ifdef ARRAY__MREMAP
+#include <sys/mman.h>
+#include <unistd.h>
+/* only declared with _GNU_SOURCE */
+extern void *mremap(void *old_address, size_t old_size, size_t new_size, int flags, ...);
+#ifndef MREMAP_MAYMOVE
+#define MREMAP_MAYMOVE 1
+#endif
+#endif
+
 typedef char *arr_bytep;
 
+#ifdef ARRAY__MREMAP
+
+/* A mapping starts with its size, so it can be unmapped without the element size */
+#define ARRAY__MAP_PREFIX 16
+#define array__mapping(head)    ((arr_bytep)(head) - ARRAY__MAP_PREFIX)
+#define array__mapping_sz(head) (*(size_t*)array__mapping(head))
+
+static
+size_t array__mapping_sz_for(array_size_t cap, size_t sz)
+{
+	const size_t page_sz = (size_t)sysconf(_SC_PAGESIZE);
+	const size_t bytes = ARRAY__MAP_PREFIX + sizeof(array__head) + cap * sz;
+	return (bytes + page_sz - 1) / page_sz * page_sz;
+}
+
+/* Moves a heap array into its own mapping */
+static
+array__head *array__map(array__head *src, array_size_t nmemb, size_t sz  MEMCALL_ARGS)
+{
+	const size_t map_sz = array__mapping_sz_for(nmemb, sz);
+	arr_bytep mapping = mmap(NULL, map_sz, PROT_READ | PROT_WRITE,
+	                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	array__head *head;
+	if (mapping == MAP_FAILED)
+		return NULL;
+	*(size_t*)mapping = map_sz;
+	head = (array__head*)(mapping + ARRAY__MAP_PREFIX);
+	memcpy(head, src, sizeof(array__head) + src->sz * sz);
+	head->cap = nmemb | ARRAY__MAPPED;
+	src->allocator->free_(src, src->allocator  MEMCALL_VARS);
+	return head;
+}
+
+static
+array__head *array__remap(array__head *head, array_size_t nmemb, size_t sz)
+{
+	const size_t old_sz = array__mapping_sz(head);
+	const size_t new_sz = array__mapping_sz_for(nmemb, sz);
+	if (new_sz != old_sz) {
+		arr_bytep mapping = mremap(array__mapping(head), old_sz, new_sz, MREMAP_MAYMOVE);
+		if (mapping == MAP_FAILED)
+			return NULL;
+		*(size_t*)mapping = new_sz;
+		head = (array__head*)(mapping + ARRAY__MAP_PREFIX);
+	}
+	head->cap = nmemb | ARRAY__MAPPED;
+	return head;
+}
+
+static
+void array__unmap(array__head *head)
+{
+	munmap(array__mapping(head), array__mapping_sz(head));
+}
+
+/* Moves a mapped array back onto its allocator */
+static
+array__head *array__unmap_to_heap(array__head *src, array_size_t nmemb, size_t sz
+                                  MEMCALL_ARGS)
+{
+	array__head *head = src->allocator->malloc_(sizeof(array__head) + nmemb * sz,
+	                                            src->allocator  MEMCALL_VARS);
+	if (!head)
+		return NULL;
+	memcpy(head, src, sizeof(array__head) + src->sz * sz);
+	head->cap = nmemb;
+	array__unmap(src);
+	return head;
+}
+
+/* Tracked & temporary allocators keep their arrays, so usage stays visible */
+static
+b32 array__mappable(const array__head *head, array_size_t nmemb, size_t sz)
+{
+	return head->allocator->realloc_ == default_realloc
+	    && sizeof(array__head) + nmemb * sz >= ARRAY_MREMAP_THRESHOLD;
+}
+
+#endif // ARRAY__MREMAP
+
 ARRDEF void *array__create(array_size_t cap, size_t sz, allocator_t *a
                            MEMCALL_ARGS)
 {
-	array__head *head = a->malloc_(sizeof(array__head) + cap * sz, a  MEMCALL_VARS);
+	array__head *head;
+	if (cap > ARRAY_MAX_CAP) { fatal("array__create: capacity exceeded"); }
+	head = a->malloc_(sizeof(array__head) + cap * sz, a  MEMCALL_VARS);
 	if (!head) { fatal("array__create: oom"); }
 	head->sz = 0;
 	head->cap = cap;
@@ -138,20 +276,93 @@ ARRDEF void *array__create(array_size_t cap, size_t sz, allocator_t *a
 	return head + 1;
 }
 
+ARRDEF void *array__init_inline(void *buf, array_size_t cap, allocator_t *a)
+{
+	/* storage has at least sizeof(array__head) bytes before buf */
+	array__head *head = (array__head*)buf - 1;
+	assert(cap <= ARRAY_MAX_CAP);
+	head->sz = 0;
+	head->cap = cap | ARRAY__INLINE;
+	head->allocator = a;
+	return buf;
+}
+
+ARRDEF void array__destroy(void *array  MEMCALL_ARGS)
+{
+	array__head *head = array__get_head(array);
+	if (head->cap & ARRAY__INLINE)
+		return;
+#ifdef ARRAY__MREMAP
+	if (head->cap & ARRAY__MAPPED) {
+		array__unmap(head);
+		return;
+	}
+#endif
+	head->allocator->free_(head, head->allocator  MEMCALL_VARS);
+}
+
+/* Moves an inline array into memory from its allocator */
+static
+void *array__spill(void *array, array_size_t nmemb, size_t sz  MEMCALL_ARGS)
+{
+	array__head *src = array__get_head(array), *head;
+	allocator_t *a = src->allocator;
+	if (!a) { fatal("array__spill: fixed capacity exceeded"); }
+	head = a->malloc_(sizeof(array__head) + nmemb * sz, a  MEMCALL_VARS);
+	if (!head) { fatal("array__spill: oom"); }
+	memcpy(head + 1, array, src->sz * sz);
+	head->sz = src->sz;
+	head->cap = nmemb;
+	head->allocator = a;
+	return head + 1;
+}
+
 ARRDEF void *array__reserve(void *array, array_size_t nmemb, size_t sz
                             MEMCALL_ARGS)
 {
 	array__head *head = array__get_head(array);
-	if (nmemb > head->cap) {
-		head = head->allocator->realloc_(head, sizeof(array__head) + nmemb * sz,
-		                                 head->allocator  MEMCALL_VARS);
+	if (nmemb > array_cap(array)) {
+		if (nmemb > ARRAY_MAX_CAP) { fatal("array__reserve: capacity exceeded"); }
+		if (head->cap & ARRAY__INLINE)
+			return array__spill(array, nmemb, sz  MEMCALL_VARS);
+#ifdef ARRAY__MREMAP
+		if (head->cap & ARRAY__MAPPED)
+			head = array__remap(head, nmemb, sz);
+		else if (array__mappable(head, nmemb, sz))
+			head = array__map(head, nmemb, sz  MEMCALL_VARS);
+		else
+#endif
+		if ((head = head->allocator->realloc_(head, sizeof(array__head) + nmemb * sz,
+		                                      head->allocator  MEMCALL_VARS)))
+			head->cap = nmemb;
 		if (!head) { fatal("array__reserve: oom"); }
-		head->cap = nmemb;
 		return head + 1;
 	}
 	return array;
 }
 
+ARRDEF void *array__shrink(void *array, size_t sz  MEMCALL_ARGS)
+{
+	array__head *head = array__get_head(array);
+	const array_size_t nmemb = head->sz;
+
+	if ((head->cap & ARRAY__INLINE) || nmemb == array_cap(array))
+		return array;
+
+#ifdef ARRAY__MREMAP
+	if (head->cap & ARRAY__MAPPED)
+		head = array__mappable(head, nmemb, sz)
+		     ? array__remap(head, nmemb, sz)
+		     : array__unmap_to_heap(head, nmemb, sz  MEMCALL_VARS);
+	else
+#endif
+	if ((head = head->allocator->realloc_(head, sizeof(array__head) + nmemb * sz,
+	                                      head->allocator  MEMCALL_VARS)))
+		head->cap = nmemb;
+	if (!head) { fatal("array__shrink: oom"); }
+	return head + 1;
+}
+
 ARRDEF void *array__copy(void *dst, const void *src, size_t sz  MEMCALL_ARGS)
 {
 	dst = array__reserve(dst, array_sz(src), sz  MEMCALL_VARS);
@@ -162,10 +373,13 @@ ARRDEF void *array__copy(void *dst, const void *src, size_t sz  MEMCALL_ARGS)
 
 ARRDEF void *array__grow(void *a, array_size_t nmemb, size_t sz  MEMCALL_ARGS)
 {
-	const array_size_t req = array_sz(a) + nmemb;
-	return req > array_cap(a)
-	     ? array__reserve(a, max(req, array_cap(a)*3/2), sz  MEMCALL_VARS)
-	     : a;
+	/* in size_t, so neither the request nor the growth wraps */
+	const size_t req = (size_t)array_sz(a) + nmemb;
+	if (req <= array_cap(a))
+		return a;
+	if (req > ARRAY_MAX_CAP) { fatal("array__grow: capacity exceeded"); }
+	return array__reserve(a, (array_size_t)min(max(req, (size_t)array_cap(a)*3/2),
+	                                           (size_t)ARRAY_MAX_CAP), sz  MEMCALL_VARS);
 }
 
 ARRDEF void *array__append_null(void *a, size_t sz  MEMCALL_ARGS)
@@ -187,23 +401,30 @@ ARRDEF void *array__appendn(void *a, const void *p, array_size_t n, size_t sz
 ARRDEF void *array__insert_null(void *a, array_size_t idx, size_t sz
                                 MEMCALL_ARGS)
 {
+	return array__insert_n(a, idx, NULL, 1, sz  MEMCALL_VARS);
+}
+
+ARRDEF void *array__insert_n(void *a, array_size_t idx, const void *p,
+                             array_size_t n, size_t sz  MEMCALL_ARGS)
+{
+	arr_bytep dst;
 	assert(idx <= array_sz(a));
-	a = array__append_null(a, sz  MEMCALL_VARS);
-	for (arr_bytep p = (arr_bytep)a+(array_sz(a)-1)*sz,
-	               end = (arr_bytep)a+idx*sz;
-	     p != end; p -= sz)
-		memcpy(p, p - sz, sz);
+	a = array__grow(a, n, sz  MEMCALL_VARS);
+	dst = (arr_bytep)a + idx * sz;
+	memmove(dst + n * sz, dst, (array_sz(a) - idx) * sz);
+	if (p)
+		memcpy(dst, p, n * sz);
+	array_sz(a) += n;
 	return a;
 }
 
 ARRDEF void array__remove(void *a, array_size_t idx, array_size_t n, size_t sz)
 {
-	assert(n > 0);
-	assert(idx + n - 1 < array_sz(a));
-	for (arr_bytep p = (arr_bytep)a + (idx + n) * sz,
-	               end = (arr_bytep)a + array_sz(a) * sz;
-	     p != end; p += sz)
-		memcpy(p - n * sz, p, sz);
+	arr_bytep dst = (arr_bytep)a + idx * sz;
+	assert(idx + n <= array_sz(a));
+	if (n == 0)
+		return;
+	memmove(dst, dst + n * sz, (array_sz(a) - idx - n) * sz);
 	array_sz(a) -= n;
 }
 
@@ -203,6 +203,21 @@ void  default_free(void *ptr, allocator_t *a  MEMCALL_ARGS);
 /* Temporary memory allocator */
 extern thread_local allocator_t *g_temp_allocator;
 
+/* Running totals of the calling thread's allocations through the default,
+ * tracked & temp allocators, which the profiler samples to attribute
+ * allocations to blocks */
+typedef struct alloc_counters
+{
+	size_t allocs; /* malloc, calloc & realloc calls */
+	size_t bytes;
+	size_t pages; /* pages temp allocators took from their heap */
+} alloc_counters_t;
+
+extern thread_local alloc_counters_t g_alloc_counters;
+
+#define alloc_counters__record(sz) \
+	(g_alloc_counters.allocs += 1, g_alloc_counters.bytes += (sz))
+
 #define PGB_MALLOC std_malloc
 #define PGB_FREE   std_free
 #ifdef VLT_TRACK_MEMORY
@@ -211,6 +226,11 @@ extern thread_local allocator_t *g_temp_allocator;
 #define PGB_LOG log_warn
 #define PGB_LOG_ALLOC log_alloc
 #define PGB_LOG_REALLOC log_realloc
+#define PGB_ON_ADD_PAGE(page_size) (g_alloc_counters.pages += 1)
+/* temp memory pages come from reserved address space, define VLT_NO_MMAP to use malloc */
+#if defined(__linux__) && !defined(VLT_NO_MMAP)
+#define PGB_MMAP
+#endif
 #include "violet/pgb.h"
 
 typedef pgb_watermark_t temp_memory_mark_t;
@@ -230,6 +250,7 @@ void  temp_free(void *ptr, allocator_t *a  MEMCALL_ARGS);
 typedef struct alloc_node
 {
 	struct alloc_node *prev, *next;
+	struct alloc_tracker *tracker;
 	size_t sz, generation;
 	const char *location;
 } alloc_node_t;
@@ -251,6 +272,41 @@ void *tracked_calloc(size_t nmemb, size_t size, allocator_t *a  MEMCALL_ARGS);
 void *tracked_realloc(void *ptr, size_t size, allocator_t *a  MEMCALL_ARGS);
 void  tracked_free(void *ptr, allocator_t *a  MEMCALL_ARGS);
 
+/* Pool allocator
+ * Serves small allocations from fixed-size blocks carved out of pages, one
+ * intrusive free list per size class, so many same-sized objects (list nodes,
+ * events, stores) are packed together.  Larger allocations go straight to the
+ * backing allocator, but are still released by pool_destroy.  Allocations are
+ * aligned like malloc's.  A pool is not thread-safe - give each thread its own. */
+#ifndef POOL_PAGE_SIZE
+#define POOL_PAGE_SIZE (64 * 1024)
+#endif
+#define POOL_MIN_BLOCK_SIZE 32
+#define POOL_CLASSES        7
+
+typedef struct pool_page
+{
+	struct pool_page *next;
+	u64 padding;
+} pool_page_t;
+
+typedef struct pool
+{
+	allocator_t *backing;
+	void *free_blocks[POOL_CLASSES];
+	pool_page_t *pages;
+	size_t num_pages;
+	struct pool__large *large; /* allocations too big for a size class */
+} pool_t;
+
+void  pool_init(pool_t *pool, allocator_t *backing);
+void  pool_destroy(pool_t *pool);
+
+void *pool_malloc(size_t size, allocator_t *a  MEMCALL_ARGS);
+void *pool_calloc(size_t nmemb, size_t size, allocator_t *a  MEMCALL_ARGS);
+void *pool_realloc(void *ptr, size_t size, allocator_t *a  MEMCALL_ARGS);
+void  pool_free(void *ptr, allocator_t *a  MEMCALL_ARGS);
+
 void vlt_mem_advance_gen(void);
 void vlt_mem_stats(size_t *global_bytes_used, size_t *global_bytes_peak,
                    size_t *global_bytes_total, size_t *global_alloc_count,
@@ -496,52 +552,191 @@ void fatal(const char *msg)
 
 #include <SDL2/SDL_thread.h>
 
-typedef struct global_alloc_tracker
+/* Each thread records its allocations in one of several shards, so threads
+ * rarely contend for the same lock.  Frees & reallocs lock the shard that
+ * owns the allocation, which may belong to another thread.  Current & peak
+ * usage are kept in atomic counters across all shards; the remaining totals
+ * are summed when queried. */
+#ifndef VLT_TRACK_MEMORY_SHARDS
+#define VLT_TRACK_MEMORY_SHARDS 16
+#endif
+
+typedef struct global_alloc_shard
 {
 	SDL_mutex *mutex;
 	alloc_tracker_t tracker;
+} global_alloc_shard_t;
+
+typedef struct global_alloc_tracker
+{
+	global_alloc_shard_t shards[VLT_TRACK_MEMORY_SHARDS];
+	volatile size_t current_bytes, peak_bytes;
+	volatile size_t num_threads;
 } global_alloc_tracker_t;
 
+static thread_local global_alloc_shard_t *g_alloc_shard = NULL;
+
+static
+size_t vlt__atomic_add(volatile size_t *p, size_t v)
+{
+#ifdef _MSC_VER
+	return (size_t)_InterlockedExchangeAdd64((volatile __int64*)p, (__int64)v) + v;
+#else
+	return __atomic_add_fetch(p, v, __ATOMIC_RELAXED);
+#endif
+}
+
+static
+size_t vlt__atomic_load(volatile size_t *p)
+{
+#ifdef _MSC_VER
+	return *p;
+#else
+	return __atomic_load_n(p, __ATOMIC_RELAXED);
+#endif
+}
+
+static
+void vlt__atomic_max(volatile size_t *p, size_t v)
+{
+	size_t cur = vlt__atomic_load(p);
+#ifdef _MSC_VER
+	while (cur < v) {
+		const size_t prev = (size_t)_InterlockedCompareExchange64((volatile __int64*)p,
+		                                                          (__int64)v, (__int64)cur);
+		if (prev == cur)
+			break;
+		cur = prev;
+	}
+#else
+	while (cur < v && !__atomic_compare_exchange_n(p, &cur, v, true,
+	                                               __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+#endif
+}
+
+static
+global_alloc_shard_t *global_tracker__thread_shard(global_alloc_tracker_t *global_tracker)
+{
+	if (!g_alloc_shard) {
+		const size_t idx = vlt__atomic_add(&global_tracker->num_threads, 1) - 1;
+		g_alloc_shard = &global_tracker->shards[idx % VLT_TRACK_MEMORY_SHARDS];
+	}
+	return g_alloc_shard;
+}
+
+static
+global_alloc_shard_t *global_tracker__ptr_shard(void *ptr)
+{
+	const alloc_node_t *node = (alloc_node_t*)ptr - 1;
+	return (global_alloc_shard_t*)((u8*)node->tracker - offsetof(global_alloc_shard_t, tracker));
+}
+
+static
+void global_tracker__record(global_alloc_tracker_t *global_tracker,
+                            size_t bytes_before, size_t bytes_after)
+{
+	const size_t current = vlt__atomic_add(&global_tracker->current_bytes,
+	                                       bytes_after - bytes_before);
+	if (bytes_after > bytes_before)
+		vlt__atomic_max(&global_tracker->peak_bytes, current);
+}
+
 void *global_tracked_malloc(size_t size, allocator_t *a  MEMCALL_ARGS)
 {
 	global_alloc_tracker_t *global_tracker = a->udata;
-	allocator_t a_ = allocator_create(tracked, &global_tracker->tracker);
+	global_alloc_shard_t *shard = global_tracker__thread_shard(global_tracker);
+	allocator_t a_ = allocator_create(tracked, &shard->tracker);
+	size_t bytes_before, bytes_after;
 	void *p;
-	SDL_LockMutex(global_tracker->mutex);
+	SDL_LockMutex(shard->mutex);
+	bytes_before = shard->tracker.current_bytes;
 	p = tracked_malloc(size, &a_  MEMCALL_VARS);
-	SDL_UnlockMutex(global_tracker->mutex);
+	bytes_after = shard->tracker.current_bytes;
+	SDL_UnlockMutex(shard->mutex);
+	global_tracker__record(global_tracker, bytes_before, bytes_after);
 	return p;
 }
 
 void *global_tracked_calloc(size_t nmemb, size_t size, allocator_t *a  MEMCALL_ARGS)
 {
 	global_alloc_tracker_t *global_tracker = a->udata;
-	allocator_t a_ = allocator_create(tracked, &global_tracker->tracker);
+	global_alloc_shard_t *shard = global_tracker__thread_shard(global_tracker);
+	allocator_t a_ = allocator_create(tracked, &shard->tracker);
+	size_t bytes_before, bytes_after;
 	void *p;
-	SDL_LockMutex(global_tracker->mutex);
+	SDL_LockMutex(shard->mutex);
+	bytes_before = shard->tracker.current_bytes;
 	p = tracked_calloc(nmemb, size, &a_  MEMCALL_VARS);
-	SDL_UnlockMutex(global_tracker->mutex);
+	bytes_after = shard->tracker.current_bytes;
+	SDL_UnlockMutex(shard->mutex);
+	global_tracker__record(global_tracker, bytes_before, bytes_after);
 	return p;
 }
 
 void *global_tracked_realloc(void *ptr, size_t size, allocator_t *a  MEMCALL_ARGS)
 {
 	global_alloc_tracker_t *global_tracker = a->udata;
-	allocator_t a_ = allocator_create(tracked, &global_tracker->tracker);
+	global_alloc_shard_t *shard = ptr ? global_tracker__ptr_shard(ptr)
+	                                  : global_tracker__thread_shard(global_tracker);
+	allocator_t a_ = allocator_create(tracked, &shard->tracker);
+	size_t bytes_before, bytes_after;
 	void *p;
-	SDL_LockMutex(global_tracker->mutex);
+	SDL_LockMutex(shard->mutex);
+	bytes_before = shard->tracker.current_bytes;
 	p = tracked_realloc(ptr, size, &a_  MEMCALL_VARS);
-	SDL_UnlockMutex(global_tracker->mutex);
+	bytes_after = shard->tracker.current_bytes;
+	SDL_UnlockMutex(shard->mutex);
+	global_tracker__record(global_tracker, bytes_before, bytes_after);
 	return p;
 }
 
 void global_tracked_free(void *ptr, allocator_t *a  MEMCALL_ARGS)
 {
 	global_alloc_tracker_t *global_tracker = a->udata;
-	allocator_t a_ = allocator_create(tracked, &global_tracker->tracker);
-	SDL_LockMutex(global_tracker->mutex);
+	global_alloc_shard_t *shard;
+	allocator_t a_;
+	size_t bytes_before, bytes_after;
+	if (!ptr)
+		return;
+	shard = global_tracker__ptr_shard(ptr);
+	a_ = allocator_create(tracked, &shard->tracker);
+	SDL_LockMutex(shard->mutex);
+	bytes_before = shard->tracker.current_bytes;
 	tracked_free(ptr, &a_  MEMCALL_VARS);
-	SDL_UnlockMutex(global_tracker->mutex);
+	bytes_after = shard->tracker.current_bytes;
+	SDL_UnlockMutex(shard->mutex);
+	global_tracker__record(global_tracker, bytes_before, bytes_after);
+}
+
+static
+void global_tracker__log_usage(global_alloc_tracker_t *global_tracker,
+                               b32 warn_active_allocations)
+{
+	size_t current_bytes = vlt__atomic_load(&global_tracker->current_bytes);
+	size_t total_bytes = 0, total_chunks = 0, total_allocs = 0;
+
+	log_info("***HEAP***");
+
+	for (u32 i = 0; i < VLT_TRACK_MEMORY_SHARDS; ++i) {
+		global_alloc_shard_t *shard = &global_tracker->shards[i];
+		SDL_LockMutex(shard->mutex);
+		if (warn_active_allocations) {
+			for (alloc_node_t *node = shard->tracker.head; node; node = node->next)
+				log_warn("%p: %6lu bytes still active from %s @ gen %lu!",
+				         node + 1, node->sz, node->location, node->generation);
+		}
+		total_bytes  += shard->tracker.total_bytes;
+		total_chunks += shard->tracker.total_chunks;
+		total_allocs += shard->tracker.total_allocs;
+		SDL_UnlockMutex(shard->mutex);
+	}
+
+	if (warn_active_allocations && current_bytes != 0)
+		log_warn("exit:  %10lu bytes still allocated!", current_bytes);
+
+	log_info("peak:  %10lu bytes", vlt__atomic_load(&global_tracker->peak_bytes));
+	log_info("total: %10lu bytes in %lu chunks, %lu (re)allocs",
+	         total_bytes, total_chunks, total_allocs);
 }
 
 
@@ -569,10 +764,14 @@ void log_realloc(const char *prefix, size_t sz  MEMCALL_ARGS)
 #define PGB_IMPLEMENTATION
 #include "violet/pgb.h"
 
+thread_local alloc_counters_t g_alloc_counters = {0};
+
 thread_local pgb_t g_temp_allocator_pgb    = {0};
 thread_local allocator_t g_temp_allocator_ = {0};
 thread_local allocator_t *g_temp_allocator = NULL;
 
+/* Each thread caches a few pages in its heap & shares the rest through the pool */
+pgb_pool_t g_temp_memory_pool;
 thread_local pgb_heap_t g_temp_memory_heap = { .first_page = NULL };
 
 allocator_t temp_memory_fork_(pgb_t *pgb)
@@ -605,16 +804,19 @@ void temp_memory_merge_all(void)
 
 void *default_malloc(size_t size, allocator_t *a  MEMCALL_ARGS)
 {
+	alloc_counters__record(size);
 	return std_malloc(size);
 }
 
 void *default_calloc(size_t nmemb, size_t size, allocator_t *a  MEMCALL_ARGS)
 {
+	alloc_counters__record(nmemb * size);
 	return std_calloc(nmemb, size);
 }
 
 void *default_realloc(void *ptr, size_t size, allocator_t *a  MEMCALL_ARGS)
 {
+	alloc_counters__record(size);
 	return std_realloc(ptr, size);
 }
 
@@ -628,16 +830,19 @@ void default_free(void *ptr, allocator_t *a  MEMCALL_ARGS)
 
 void *temp_malloc(size_t size, allocator_t *a  MEMCALL_ARGS)
 {
+	alloc_counters__record(size);
 	return pgb_malloc(size, a->udata  MEMCALL_VARS);
 }
 
 void *temp_calloc(size_t nmemb, size_t size, allocator_t *a  MEMCALL_ARGS)
 {
+	alloc_counters__record(nmemb * size);
 	return pgb_calloc(nmemb, size, a->udata  MEMCALL_VARS);
 }
 
 void *temp_realloc(void *ptr, size_t size, allocator_t *a  MEMCALL_ARGS)
 {
+	alloc_counters__record(size);
 	return pgb_realloc(ptr, size, a->udata  MEMCALL_VARS);
 }
 
@@ -688,6 +893,7 @@ static
 void alloc_tracker__append_node(alloc_tracker_t *tracker,
                                 alloc_node_t *node, size_t sz  MEMCALL_ARGS)
 {
+	node->tracker = tracker;
 	node->sz = sz;
 	node->generation = tracker->generation;
 	node->next = NULL;
@@ -750,6 +956,7 @@ void alloc_tracker_log_current_gen(alloc_tracker_t *tracker, size_t gen)
 void *tracked_malloc(size_t sz, allocator_t *a  MEMCALL_ARGS)
 {
 	alloc_node_t *node = std_malloc(sizeof(alloc_node_t) + sz);
+	alloc_counters__record(sz);
 	alloc_tracker__append_node(a->udata, node, sz  MEMCALL_VARS);
 	log_alloc("std", sz  MEMCALL_VARS);
 	return node + 1;
@@ -758,6 +965,7 @@ void *tracked_malloc(size_t sz, allocator_t *a  MEMCALL_ARGS)
 void *tracked_calloc(size_t nmemb, size_t sz, allocator_t *a  MEMCALL_ARGS)
 {
 	alloc_node_t *node = std_calloc(1, sizeof(alloc_node_t) + nmemb * sz);
+	alloc_counters__record(nmemb * sz);
 	alloc_tracker__append_node(a->udata, node, nmemb * sz  MEMCALL_VARS);
 	log_alloc("std", nmemb * sz  MEMCALL_VARS);
 	return node + 1;
@@ -771,6 +979,7 @@ void *tracked_realloc(void *ptr, size_t sz, allocator_t *a  MEMCALL_ARGS)
 		const size_t old_sz = old_node->sz;
 		if (sz) {
 			alloc_node_t *node = std_realloc(old_node, sizeof(alloc_node_t) + sz);
+			alloc_counters__record(sz);
 			if (node != old_node) {
 				alloc_tracker__record_free(tracker, old_sz);
 				alloc_tracker__record_alloc(tracker, sz);
@@ -827,13 +1036,214 @@ void tracked_free(void *ptr, allocator_t *a  MEMCALL_ARGS)
 	}
 }
 
+
+/* Pool allocator */
+
+/* precedes every allocation, holds the size class or POOL_CLASSES if large */
+typedef union pool__header
+{
+	u32 class_idx;
+	pgb__max_align_t align;
+} pool__header_t;
+
+typedef struct pool__large
+{
+	struct pool__large *prev;
+	struct pool__large *next;
+	pool__header_t header;
+} pool__large_t;
+
+/* blocks start after the page header, so it must keep them aligned */
+static_assert(sizeof(pool_page_t) % sizeof(pool__header_t) == 0, "misaligned pool blocks");
+
+#define pool__large_from_header(header) \
+	((pool__large_t*)((char*)(header) - offsetof(pool__large_t, header)))
+
+#define pool__block_size(class_idx) ((size_t)POOL_MIN_BLOCK_SIZE << (class_idx))
+
+void pool_init(pool_t *pool, allocator_t *backing)
+{
+	pool->backing = backing;
+	for (u32 i = 0; i < POOL_CLASSES; ++i)
+		pool->free_blocks[i] = NULL;
+	pool->pages = NULL;
+	pool->num_pages = 0;
+	pool->large = NULL;
+}
+
+void pool_destroy(pool_t *pool)
+{
+	pool_page_t *page = pool->pages;
+	pool__large_t *large = pool->large;
+	while (page) {
+		pool_page_t *next = page->next;
+		afree(page, pool->backing);
+		page = next;
+	}
+	while (large) {
+		pool__large_t *next = large->next;
+		afree(large, pool->backing);
+		large = next;
+	}
+	pool_init(pool, pool->backing);
+}
+
+static
+void pool__large_link(pool_t *pool, pool__large_t *large)
+{
+	large->prev = NULL;
+	large->next = pool->large;
+	if (pool->large)
+		pool->large->prev = large;
+	pool->large = large;
+}
+
+static
+void pool__large_unlink(pool_t *pool, pool__large_t *large)
+{
+	if (large->prev)
+		large->prev->next = large->next;
+	else
+		pool->large = large->next;
+	if (large->next)
+		large->next->prev = large->prev;
+}
+
+static
+u32 pool__class(size_t size)
+{
+	u32 class_idx = 0;
+	size += sizeof(pool__header_t);
+	while (class_idx < POOL_CLASSES && pool__block_size(class_idx) < size)
+		++class_idx;
+	return class_idx;
+}
+
+/* Carves a new page into blocks, in address order so they are handed out
+ * contiguously */
+static
+b32 pool__add_page(pool_t *pool, u32 class_idx  MEMCALL_ARGS)
+{
+	const size_t block_size = pool__block_size(class_idx);
+	const size_t num_blocks = (POOL_PAGE_SIZE - sizeof(pool_page_t)) / block_size;
+	pool_page_t *page = pool->backing->malloc_(POOL_PAGE_SIZE, pool->backing  MEMCALL_VARS);
+	char *blocks = (char*)(page + 1);
+	if (!page)
+		return false;
+	page->next = pool->pages;
+	pool->pages = page;
+	++pool->num_pages;
+	for (size_t i = num_blocks; i-- > 0; ) {
+		void **block = (void**)(blocks + i * block_size);
+		*block = pool->free_blocks[class_idx];
+		pool->free_blocks[class_idx] = block;
+	}
+	return true;
+}
+
+void *pool_malloc(size_t size, allocator_t *a  MEMCALL_ARGS)
+{
+	pool_t *pool = a->udata;
+	const u32 class_idx = pool__class(size);
+	pool__header_t *header;
+
+	if (class_idx == POOL_CLASSES) {
+		pool__large_t *large = pool->backing->malloc_(sizeof(pool__large_t) + size,
+		                                              pool->backing  MEMCALL_VARS);
+		if (!large)
+			return NULL;
+		pool__large_link(pool, large);
+		header = &large->header;
+	} else {
+		if (!pool->free_blocks[class_idx] && !pool__add_page(pool, class_idx  MEMCALL_VARS))
+			return NULL;
+		header = pool->free_blocks[class_idx];
+		pool->free_blocks[class_idx] = *(void**)header;
+	}
+	header->class_idx = class_idx;
+	return header + 1;
+}
+
+void *pool_calloc(size_t nmemb, size_t size, allocator_t *a  MEMCALL_ARGS)
+{
+	void *ptr = pool_malloc(nmemb * size, a  MEMCALL_VARS);
+	if (ptr)
+		memset(ptr, 0, nmemb * size);
+	return ptr;
+}
+
+void *pool_realloc(void *ptr, size_t size, allocator_t *a  MEMCALL_ARGS)
+{
+	pool_t *pool = a->udata;
+	pool__header_t *header;
+	void *new_ptr;
+	size_t old_size;
+
+	if (!ptr)
+		return size ? pool_malloc(size, a  MEMCALL_VARS) : NULL;
+	if (!size) {
+		pool_free(ptr, a  MEMCALL_VARS);
+		return NULL;
+	}
+
+	header = (pool__header_t*)ptr - 1;
+	if (header->class_idx == POOL_CLASSES) {
+		if (pool__class(size) == POOL_CLASSES) {
+			pool__large_t *large = pool__large_from_header(header);
+			pool__large_unlink(pool, large);
+			large = pool->backing->realloc_(large, sizeof(pool__large_t) + size,
+			                                pool->backing  MEMCALL_VARS);
+			if (!large) {
+				pool__large_link(pool, pool__large_from_header(header));
+				return NULL;
+			}
+			pool__large_link(pool, large);
+			return &large->header + 1;
+		}
+		/* size of large allocations isn't stored, but exceeds the new size */
+		old_size = size;
+	} else if (pool__class(size) == header->class_idx) {
+		return ptr;
+	} else {
+		old_size = pool__block_size(header->class_idx) - sizeof(pool__header_t);
+	}
+
+	new_ptr = pool_malloc(size, a  MEMCALL_VARS);
+	if (new_ptr) {
+		memcpy(new_ptr, ptr, min(old_size, size));
+		pool_free(ptr, a  MEMCALL_VARS);
+	}
+	return new_ptr;
+}
+
+void pool_free(void *ptr, allocator_t *a  MEMCALL_ARGS)
+{
+	if (ptr) {
+		pool_t *pool = a->udata;
+		pool__header_t *header = (pool__header_t*)ptr - 1;
+		const u32 class_idx = header->class_idx;
+		if (class_idx == POOL_CLASSES) {
+			pool__large_t *large = pool__large_from_header(header);
+			pool__large_unlink(pool, large);
+			pool->backing->free_(large, pool->backing  MEMCALL_VARS);
+		} else {
+			*(void**)header = pool->free_blocks[class_idx];
+			pool->free_blocks[class_idx] = header;
+		}
+	}
+}
+
 void vlt_mem_advance_gen(void)
 {
+	pgb_pool_advance_gen(&g_temp_memory_pool);
 #ifdef VLT_TRACK_MEMORY
 	global_alloc_tracker_t *global_tracker = g_allocator->udata;
-	SDL_LockMutex(global_tracker->mutex);
-	alloc_tracker_advance_gen(&global_tracker->tracker);
-	SDL_UnlockMutex(global_tracker->mutex);
+	for (u32 i = 0; i < VLT_TRACK_MEMORY_SHARDS; ++i) {
+		global_alloc_shard_t *shard = &global_tracker->shards[i];
+		SDL_LockMutex(shard->mutex);
+		alloc_tracker_advance_gen(&shard->tracker);
+		SDL_UnlockMutex(shard->mutex);
+	}
 #endif
 }
 
@@ -844,12 +1254,17 @@ void vlt_mem_stats(size_t *global_bytes_used, size_t *global_bytes_peak,
 	size_t temp_pages_used, temp_pages_available;
 #ifdef VLT_TRACK_MEMORY
 	global_alloc_tracker_t *global_tracker = g_allocator->udata;
-	SDL_LockMutex(global_tracker->mutex);
-	*global_bytes_used  = global_tracker->tracker.current_bytes;
-	*global_bytes_peak  = global_tracker->tracker.peak_bytes;
-	*global_bytes_total = global_tracker->tracker.total_bytes;
-	*global_alloc_count = global_tracker->tracker.total_allocs;
-	SDL_UnlockMutex(global_tracker->mutex);
+	*global_bytes_used  = vlt__atomic_load(&global_tracker->current_bytes);
+	*global_bytes_peak  = vlt__atomic_load(&global_tracker->peak_bytes);
+	*global_bytes_total = 0;
+	*global_alloc_count = 0;
+	for (u32 i = 0; i < VLT_TRACK_MEMORY_SHARDS; ++i) {
+		global_alloc_shard_t *shard = &global_tracker->shards[i];
+		SDL_LockMutex(shard->mutex);
+		*global_bytes_total += shard->tracker.total_bytes;
+		*global_alloc_count += shard->tracker.total_allocs;
+		SDL_UnlockMutex(shard->mutex);
+	}
 #else
 	*global_bytes_used  = 0;
 	*global_bytes_peak  = 0;
@@ -877,12 +1292,7 @@ void vlt_mem_log_usage_(size_t temp_bytes_current, size_t temp_pages_current,
 {
 	log_info("memory diagnostic:");
 #ifdef VLT_TRACK_MEMORY
-	{
-		global_alloc_tracker_t *global_tracker = g_allocator->udata;
-		SDL_LockMutex(global_tracker->mutex);
-		alloc_tracker_log_usage(&global_tracker->tracker, warn_active_allocations);
-		SDL_UnlockMutex(global_tracker->mutex);
-	}
+	global_tracker__log_usage(g_allocator->udata, warn_active_allocations);
 #endif
 	log_info("***TEMP***");
 	log_info("temp:");
@@ -1427,10 +1837,13 @@ void vlt_init(vlt_thread_type_e thread_type)
 #ifdef VLT_TRACK_MEMORY
 	if (thread_type == VLT_THREAD_MAIN) {
 		global_alloc_tracker_t *global_tracker = g_allocator->udata;
-		global_tracker->mutex = SDL_CreateMutex();
+		for (u32 i = 0; i < VLT_TRACK_MEMORY_SHARDS; ++i)
+			global_tracker->shards[i].mutex = SDL_CreateMutex();
 	}
 #endif
-	pgb_heap_init(&g_temp_memory_heap);
+	if (thread_type == VLT_THREAD_MAIN)
+		pgb_pool_init(&g_temp_memory_pool);
+	pgb_heap_init_pooled(&g_temp_memory_heap, &g_temp_memory_pool);
 	g_temp_allocator_ = allocator_create(temp, &g_temp_allocator_pgb);
 	g_temp_allocator  = &g_temp_allocator_;
 	pgb_init(g_temp_allocator->udata, &g_temp_memory_heap);
@@ -1452,13 +1865,17 @@ void vlt_destroy(vlt_thread_type_e thread_type)
 	pgb_stats(pgb, &bytes_used, &pages_used, &bytes_total, &pages_total);
 	pgb_destroy(pgb);
 	pgb_heap_destroy(&g_temp_memory_heap);
+	/* other threads must be destroyed before the main thread */
+	if (thread_type == VLT_THREAD_MAIN)
+		pgb_pool_destroy(&g_temp_memory_pool);
 	vlt_mem_log_usage_(bytes_used, pages_used, bytes_total, pages_total,
 	                   thread_type == VLT_THREAD_MAIN);
 	g_temp_allocator = NULL;
 #ifdef VLT_TRACK_MEMORY
 	if (thread_type == VLT_THREAD_MAIN) {
 		global_alloc_tracker_t *global_tracker = g_allocator->udata;
-		SDL_DestroyMutex(global_tracker->mutex);
+		for (u32 i = 0; i < VLT_TRACK_MEMORY_SHARDS; ++i)
+			SDL_DestroyMutex(global_tracker->shards[i].mutex);
 	}
 #endif
 }
@@ -277,6 +277,16 @@ out:
 	return bytes;
 }
 
+const void *file_map(const char *fname, size_t *sz)
+{
+	return file_read_all(fname, "rb", sz, g_allocator);
+}
+
+void file_unmap(const void *data, size_t sz)
+{
+	afree((void*)data, g_allocator);
+}
+
 /* Dynamic library */
 
 #ifndef VIOLET_NO_LIB
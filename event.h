@@ -8,6 +8,11 @@
 #define EVENT_DESCRIPTION_SIZE 64
 #define NAV_DESCRIPTION_SIZE   16
 
+/* most events have few or no children, so they don't need an allocation */
+#ifndef EVENT_INLINE_CHILDREN
+#define EVENT_INLINE_CHILDREN 2
+#endif
+
 typedef struct event_contract {
 	void (*create    )(void *instance, allocator_t *alc);
 	void (*destroy   )(void *instance, allocator_t *alc);
@@ -40,11 +45,14 @@ typedef struct event_metadata {
 typedef struct event {
 	const event_metadata_t *meta;
 	array(struct event *) children;
+	array_storage(struct event *, EVENT_INLINE_CHILDREN) children_storage;
 	char nav_description[NAV_DESCRIPTION_SIZE];
 	s64 time_since_epoch_ms;
     /* expect event_kind_e */
 	u32 kind;
 	s32 status;
+	/* owned by a transaction arena, which frees it wholesale */
+	b32 from_arena;
 	char instance[];
 } event_t;
 
@@ -159,7 +167,7 @@ event_t *event_create_empty(u32 kind, const event_metadata_t *meta,
 	else
 		event->nav_description[0] = 0;
 	event->time_since_epoch_ms = time_milliseconds_since_epoch();
-	event->children = array_create_ex(alc);
+	array_init_inline(event->children, event->children_storage, alc);
 	return event;
 }
 
@@ -172,7 +180,8 @@ void event_destroy(event_t *event, allocator_t *alc)
 
 	if (event->meta->contract->destroy)
 		(event->meta->contract->destroy)(event->instance, alc);
-	afree(event, alc);
+	if (!event->from_arena)
+		afree(event, alc);
 }
 
 b32 event_execute(event_t *event)
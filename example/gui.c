@@ -2,8 +2,8 @@
 
 #include "GL/glew.h"
 
-#define GUI_MAX_VERTS 16384
-#define GUI_MAX_DRAW_CALLS 4096
+#define GUI_VERT_CHUNK_SZ 16384
+#define GUI_DRAW_CALL_CHUNK_SZ 4096
 #define GUI_MAX_SCISSORS 32
 #define GUI_USE_CURSOR_BUTTON
 
@@ -157,7 +157,7 @@ void gui_npt_txt_translate(gui_t *gui, s32 x, s32 y, s32 w, s32 h, const char *t
 		if (!gui_npt_txt(gui, x, y, w, h, s_translation, n, txt, flags))
 			{} /* skip */
 		else if (localization_table_save_translation(&g_localization_table, txt, s_translation))
-			{} // (void)localize_save_language(fname);
+			localize_invalidate(); // (void)localize_save_language(fname);
 		else
 			log_error("failed to find string \"%s\"", txt);
 	} else if (gui_any_widget_has_focus(gui)) {
@@ -256,6 +256,24 @@ gui_fonts_t gui_get_fonts(const gui_t *gui);
 void gui_mask_push(gui_t *gui, s32 x, s32 y, s32 w, s32 h);
 void gui_mask_pop(gui_t *gui);
 
+/* Cached layers are an opt-in retained mode for static content.  Everything
+ * drawn between gui_layer_cache_begin() and gui_layer_cache_end() goes into
+ * its own masked layer.  That geometry is recorded and replayed as-is on
+ * later frames, until the hash of the caller's inputs changes or the layer
+ * is invalidated.  begin returns true when the content must be drawn.
+ *
+ * if (gui_layer_cache_begin(gui, id, hash, x, y, w, h)) {
+ *   gui_rect(gui, ...);
+ *   gui_txt(gui, ...);
+ * }
+ * gui_layer_cache_end(gui);
+ *
+ * Replayed content does not see input, so keep widgets out of cached layers.
+ * Caches that go unused for a frame are released. */
+b32  gui_layer_cache_begin(gui_t *gui, u64 id, u32 hash, s32 x, s32 y, s32 w, s32 h);
+void gui_layer_cache_end(gui_t *gui);
+void gui_layer_cache_invalidate(gui_t *gui, u64 id);
+
 void gui_hint_render(gui_t *gui, u64 id, const char *hint);
 
 typedef struct gui_line_style gui_line_style_t;
@@ -286,6 +304,19 @@ b32  gui_box_visible(const gui_t *gui, s32 x, s32 y, s32 w, s32 h);
 
 /* Render buffer */
 
+/* When GUI_USE_INDEXED_GEOMETRY is defined, every draw call is converted to a
+ * list type (points, lines or triangles) over shared vertices, and its
+ * idx/cnt refer to the index buffer instead of the vertex buffer. */
+typedef u32 gui_index_t;
+
+/* Vertices are interleaved so a backend can stream them in a single copy */
+typedef struct gui_vertex
+{
+	v2f pos;
+	v2f tex_coord;
+	color_t color;
+} gui_vertex_t;
+
 typedef struct gui_draw_call
 {
 	u32 idx;
@@ -307,24 +338,62 @@ typedef struct gui_render_output
 	u32 num_layers;
 	const gui_layer_t *layers;
 	u32 num_verts;
-	struct {
-		const v2f *pos;
-		const color_t *color;
-		const v2f *tex_coord;
-	} verts;
+	const gui_vertex_t *verts;
+	u32 num_indices;
+	const gui_index_t *indices; /* NULL unless GUI_USE_INDEXED_GEOMETRY */
 	u32 num_draw_calls;
 	const gui_draw_call_t *draw_calls;
 } gui_render_output_t;
 
 u32  gui_num_layers(const gui_t *gui);
 u32  gui_vert_cnt(const gui_t *gui);
+u32  gui_index_cnt(const gui_t *gui);
 u32  gui_draw_call_cnt(const gui_t *gui);
 u32  gui_culled_vert_cnt(const gui_t *gui);
 u32  gui_culled_draw_call_cnt(const gui_t *gui);
 u32  gui_culled_widget_cnt(const gui_t *gui);
+/* Draw calls folded into their predecessor by gui_end_frame. Before the frame
+ * ends, gui_draw_call_cnt() is the unmerged count; after, it is the merged one. */
+u32  gui_merged_draw_call_cnt(const gui_t *gui);
+/* The output points into buffers that may be reallocated by later drawing */
 void gui_get_render_output(const gui_t *gui, gui_render_output_t *output);
 
 
+/* Frame metrics */
+
+/* Number of recent frames whose metrics are kept */
+#ifndef GUI_FRAME_METRICS_CAPACITY
+#define GUI_FRAME_METRICS_CAPACITY 256
+#endif
+
+/* The overlay marks this frame time & scales its graph to at least it */
+#ifndef GUI_FRAME_METRICS_TARGET_MICRO
+#define GUI_FRAME_METRICS_TARGET_MICRO 16667
+#endif
+
+typedef struct gui_frame_metrics
+{
+	u32 frame_micro;  /* until the next frame began, 0 for the current frame */
+	u32 build_micro;  /* from gui_begin_frame to the end of gui_end_frame */
+	u32 submit_micro; /* as reported by the backend, e.g. window_end_frame */
+	u32 verts;
+	u32 draw_calls;
+	u32 culled_verts;
+	u32 culled_draw_calls;
+	u32 culled_widgets;
+	u32 temp_bytes;   /* temp memory in use when the frame was built */
+} gui_frame_metrics_t;
+
+/* gui_end_frame records the frame's metrics, except for the submit time */
+void gui_frame_metrics_set_submit_micro(gui_t *gui, u32 submit_micro);
+u32  gui_frame_metrics_cnt(const gui_t *gui);
+/* 0 is the most recently ended frame */
+const gui_frame_metrics_t *gui_frame_metrics(const gui_t *gui, u32 frames_ago);
+/* Graphs the build & submit time of recent frames over everything else, along
+ * with the latest & worst metrics */
+void gui_frame_metrics_overlay(gui_t *gui, s32 x, s32 y, s32 w, s32 h);
+
+
 
 /* Widgets */
 
@@ -1136,49 +1205,23 @@ void gui_align_anchor(s32 x, s32 y, s32 w, s32 h, gui_align_e align, s32 *px, s3
 }
 
 static
-s32 font__line_width(void *font, const char *txt, gui_char_quad_f get_char_quad)
-{
-	const char *p = txt;
-	char *pnext;
-	s32 cp;
-	gui_char_quad_t q;
-	r32 width = 0;
-
-	while ((cp = utf8_next_codepoint(p, &pnext)) != 0) {
-		p = pnext;
-		if (cp == '\n')
-			goto out;
-		else if (get_char_quad(font, cp, width, 0, &q))
-			width += q.advance;
-	}
-out:
-	return width;
-}
-
-static
-s32 font__line_offset_x(void *font, const char *txt,
-                        s32 align, s32 padding,
-                        gui_char_quad_f get_char_quad)
+s32 font__align_x(s32 line_width, s32 align, s32 padding)
 {
 	if (align & GUI_ALIGN_CENTER)
-		return -font__line_width(font, txt, get_char_quad) / 2;
+		return -line_width / 2;
 	else if (align & GUI_ALIGN_RIGHT)
-		return -(font__line_width(font, txt, get_char_quad) + padding);
+		return -(line_width + padding);
 	else /* default to GUI_ALIGN_LEFT */
 		return padding;
 }
 
 static
-s32 font__offset_y(void *font, const char *txt,
-                   s32 align, s32 padding,
+s32 font__offset_y(u32 line_cnt, s32 align, s32 padding,
                    const gui_font_metrics_t *m)
 {
 	s32 height;
 	if (align & GUI_ALIGN_MIDDLE) {
-		height = 1;
-		for (const char *c = txt; *c != '\0'; ++c)
-			if (*c == '\n')
-				++height;
+		height = line_cnt;
 		return   height % 2 == 0
 		       ? -m->descent + m->line_gap + m->newline_dist * (height / 2 - 1)
 		       :   -m->descent - (m->ascent - m->descent) / 2
@@ -1187,9 +1230,7 @@ s32 font__offset_y(void *font, const char *txt,
 		return -m->ascent - m->line_gap / 2 - padding;
 	} else /* default to GUI_ALIGN_BOTTOM */ {
 		height = -m->descent + m->line_gap / 2 + padding;
-		for (const char *c = txt; *c != '\0'; ++c)
-			if (*c == '\n')
-				height += m->newline_dist;
+		height += m->newline_dist * (line_cnt - 1);
 		return height;
 	}
 }
@@ -1641,12 +1682,14 @@ const gui_style_t g_gui_style_invis = {
 const gui_padding_style_t g_gui_padding_none = {0};
 
 
-#ifndef GUI_MAX_VERTS
-#define GUI_MAX_VERTS 4096
+/* The vertex & draw call buffers grow in multiples of these chunk sizes and
+ * keep their high-water mark capacity from frame to frame. */
+#ifndef GUI_VERT_CHUNK_SZ
+#define GUI_VERT_CHUNK_SZ 4096
 #endif
 
-#ifndef GUI_MAX_DRAW_CALLS
-#define GUI_MAX_DRAW_CALLS 1024
+#ifndef GUI_DRAW_CALL_CHUNK_SZ
+#define GUI_DRAW_CALL_CHUNK_SZ 1024
 #endif
 
 #ifndef GUI_MAX_LAYERS
@@ -1657,8 +1700,9 @@ const gui_padding_style_t g_gui_padding_none = {0};
 #define GUI_MASK_STACK_LIMIT 8
 #endif
 
-#define GUI__LAYER_PRIORITY_HINT  2
-#define GUI__LAYER_PRIORITY_POPUP 1
+#define GUI__LAYER_PRIORITY_OVERLAY 3
+#define GUI__LAYER_PRIORITY_HINT    2
+#define GUI__LAYER_PRIORITY_POPUP   1
 
 /* IDs:  0....1........X.........X.........UINT_MAX
  *       ^         ^         ^        ^        ^
@@ -1716,6 +1760,44 @@ typedef struct gui_mouse_press {
 	v2i pos;
 } gui_mouse_press_t;
 
+#ifndef GUI_GLYPH_RUN_CACHE_SETS
+#define GUI_GLYPH_RUN_CACHE_SETS 256
+#endif
+
+#define GUI__GLYPH_RUN_CACHE_WAYS 4
+
+typedef struct gui__glyph
+{
+	gui_char_quad_t quad; /* relative to the start of the line */
+	r32 x;                /* pen position, relative to the start of the line */
+	u32 offset, end;      /* byte range of the codepoint */
+	b32 newline;
+} gui__glyph_t;
+
+typedef struct gui__glyph_run
+{
+	void *font;
+	s32 size;
+	u32 hash;
+	u32 last_frame;
+	array(char) txt;
+	array(gui__glyph_t) glyphs;
+	array(s32) line_widths;
+} gui__glyph_run_t;
+
+typedef struct gui__layer_cache
+{
+	u64 id;
+	u32 hash;
+	box2i mask;
+	b32 valid;
+	u32 last_frame;
+	box2i bbox;
+	array(gui_vertex_t) verts;
+	array(gui_index_t) indices;
+	array(gui_draw_call_t) draw_calls;
+} gui__layer_cache_t;
+
 typedef struct gui
 {
 	timepoint_t creation_time;
@@ -1727,23 +1809,36 @@ typedef struct gui
 	u32 texture_white;
 	u32 texture_white_dotted;
 	gui_fonts_t fonts;
+	gui__glyph_run_t *glyph_runs;
 
 	/* rendering */
-	v2f verts[GUI_MAX_VERTS];
-	color_t vert_colors[GUI_MAX_VERTS];
-	v2f vert_tex_coords[GUI_MAX_VERTS];
+	allocator_t *render_alc;
+	gui_vertex_t *verts;
 	u32 vert_cnt;
-	gui_draw_call_t draw_calls[GUI_MAX_DRAW_CALLS];
+	u32 vert_cap;
+	gui_index_t *indices;
+	u32 index_cnt;
+	u32 index_cap;
+	gui_draw_call_t *draw_calls;
 	u32 draw_call_cnt;
+	u32 draw_call_cap;
 	u32 draw_call_vert_idx;
 	gui_layer_t layers[GUI_MAX_LAYERS];
 	gui_layer_t *layer;
+	array(gui__layer_cache_t) layer_caches;
+	gui__layer_cache_t *layer_cache_recording;
+	b32 layer_cache_active;
+	u32 layer_cache_vert_idx, layer_cache_index_idx, layer_cache_draw_call_idx;
+	u32 frame_idx;
 	box2i masks[GUI_MASK_STACK_LIMIT];
 	box2i *mask;
 	u32 culled_draw_calls;
 	u32 culled_vertices;
+	u32 merged_draw_calls;
 	u32 culled_widgets;
 	s32 scale;
+	gui_frame_metrics_t frame_metrics[GUI_FRAME_METRICS_CAPACITY];
+	u32 frame_metrics_cnt; /* total recorded, the last CAPACITY are kept */
 
 	void *window;
 	v2i window_dim;
@@ -1856,50 +1951,139 @@ typedef struct gui
 
 /* Font */
 
+/* Glyph runs cache the layout of a string in a font, so labels that are
+ * measured & drawn several times per frame are only decoded & queried from
+ * the font once.  Quads are stored relative to the pen at the start of their
+ * line, which assumes fonts place glyphs independently of the pen position.
+ * The cache is set-associative; a miss replaces the least recently used run
+ * in its set. */
 static
-s32 gui__txt_line_width(const gui_t *gui, const char *txt, s32 size_)
+gui__glyph_run_t *gui__glyph_run(const gui_t *gui, void *font, s32 size, const char *txt)
 {
-	const s32 size = gui_scale_val(gui, size_);
-	void *font = gui->fonts.get_font(gui->fonts.handle, gui->style.font_path, size);
-	gui_char_quad_f get_char_quad = gui->fonts.get_char_quad;
-	return font ? font__line_width(font, txt, get_char_quad) : 0;
+	const u32 hash = hash_compute(txt);
+	const u32 set_idx = (hash ^ (u32)((uintptr_t)font >> 4) ^ (u32)size)
+	                  % GUI_GLYPH_RUN_CACHE_SETS;
+	gui__glyph_run_t *set = &gui->glyph_runs[set_idx * GUI__GLYPH_RUN_CACHE_WAYS];
+	gui__glyph_run_t *run = &set[0];
+	const char *p = txt;
+	char *pnext;
+	s32 cp;
+	gui_char_quad_t q;
+	r32 x = 0;
+
+	for (u32 i = 0; i < GUI__GLYPH_RUN_CACHE_WAYS; ++i) {
+		if (   set[i].font == font
+		    && set[i].size == size
+		    && set[i].hash == hash
+		    && strcmp(set[i].txt, txt) == 0) {
+			set[i].last_frame = gui->frame_idx;
+			return &set[i];
+		}
+		if (!set[i].font || (run->font && set[i].last_frame < run->last_frame))
+			run = &set[i];
+	}
+
+	if (!run->txt) {
+		run->txt = array_create_ex(gui->render_alc);
+		run->glyphs = array_create_ex(gui->render_alc);
+		run->line_widths = array_create_ex(gui->render_alc);
+	}
+	run->font = font;
+	run->size = size;
+	run->hash = hash;
+	run->last_frame = gui->frame_idx;
+	array_clear(run->txt);
+	array_appendn(run->txt, txt, (u32)strlen(txt) + 1);
+	array_clear(run->glyphs);
+	array_clear(run->line_widths);
+
+	while ((cp = utf8_next_codepoint(p, &pnext)) != 0) {
+		if (cp == '\n') {
+			gui__glyph_t *glyph = array_append_null(run->glyphs);
+			memclr(glyph->quad);
+			glyph->x = x;
+			glyph->offset = (u32)(p - txt);
+			glyph->end = (u32)(pnext - txt);
+			glyph->newline = true;
+			array_append(run->line_widths, (s32)x);
+			x = 0;
+		} else if (gui->fonts.get_char_quad(font, cp, x, 0, &q)) {
+			gui__glyph_t *glyph = array_append_null(run->glyphs);
+			glyph->quad = q;
+			glyph->x = x;
+			glyph->offset = (u32)(p - txt);
+			glyph->end = (u32)(pnext - txt);
+			glyph->newline = false;
+			x += q.advance;
+		}
+		p = pnext;
+	}
+	array_append(run->line_widths, (s32)x);
+
+	return run;
 }
 
 static
-s32 gui__txt_line_offset_x(const gui_t *gui, const char *txt,
-                           const gui_text_style_t *style)
+void gui__glyph_runs_destroy(gui_t *gui)
 {
-	const s32 size = gui_scale_val(gui, style->size);
-	void *font = gui->fonts.get_font(gui->fonts.handle, gui->style.font_path, size);
-	const s32 align = style->align;
-	const s32 padding = gui_scale_val(gui, style->padding);
-	gui_char_quad_f get_char_quad = gui->fonts.get_char_quad;
-	return font ? font__line_offset_x(font, txt, align, padding, get_char_quad) : 0;
+	for (u32 i = 0; i < GUI_GLYPH_RUN_CACHE_SETS * GUI__GLYPH_RUN_CACHE_WAYS; ++i) {
+		gui__glyph_run_t *run = &gui->glyph_runs[i];
+		if (run->txt) {
+			array_destroy(run->txt);
+			array_destroy(run->glyphs);
+			array_destroy(run->line_widths);
+		}
+	}
+	afree(gui->glyph_runs, gui->render_alc);
 }
 
 static
-s32 gui__txt_offset_y(const gui_t *gui, const char *txt, const gui_text_style_t *style)
+gui_char_quad_t gui__glyph_quad(const gui__glyph_t *glyph, r32 line_x, r32 y)
 {
-	const s32 size = gui_scale_val(gui, style->size);
-	void *font = gui->fonts.get_font(gui->fonts.handle, gui->style.font_path, size);
-	gui_font_metrics_t metrics;
-	const s32 padding = gui_scale_val(gui, style->padding);
+	gui_char_quad_t q = glyph->quad;
+	q.x0 += line_x;
+	q.x1 += line_x;
+	q.y0 += y;
+	q.y1 += y;
+	return q;
+}
 
-	if (!font)
-		return 0;
+static
+s32 gui__glyph_run_line_x(const gui_t *gui, const gui__glyph_run_t *run, u32 line,
+                          v2i anchor, const gui_text_style_t *style)
+{
+	const s32 padding = gui_scale_val(gui, style->padding);
+	return anchor.x + font__align_x(run->line_widths[line], style->align, padding);
+}
 
-	gui->fonts.get_metrics(font, &metrics);
-	return font__offset_y(font, txt, style->align, padding, &metrics);
+static
+v2f gui__glyph_run_start_pos(const gui_t *gui, const gui__glyph_run_t *run,
+                             const gui_font_metrics_t *metrics, v2i anchor,
+                             const gui_text_style_t *style)
+{
+	const s32 padding = gui_scale_val(gui, style->padding);
+	const u32 line_cnt = array_sz(run->line_widths);
+	return (v2f) {
+		.x = gui__glyph_run_line_x(gui, run, 0, anchor, style),
+		.y = anchor.y + font__offset_y(line_cnt, style->align, padding, metrics),
+	};
 }
 
 static
 v2f gui__txt_start_pos(const gui_t *gui, const char *txt,
                        v2i anchor, const gui_text_style_t *style)
 {
-	return (v2f) {
-		.x = anchor.x + gui__txt_line_offset_x(gui, txt, style),
-		.y = anchor.y + gui__txt_offset_y(gui, txt, style),
-	};
+	const s32 size = gui_scale_val(gui, style->size);
+	void *font = gui->fonts.get_font(gui->fonts.handle, gui->style.font_path, size);
+	gui_font_metrics_t metrics;
+	const gui__glyph_run_t *run;
+
+	if (!font)
+		return (v2f){ anchor.x, anchor.y };
+
+	gui->fonts.get_metrics(font, &metrics);
+	run = gui__glyph_run(gui, font, size, txt);
+	return gui__glyph_run_start_pos(gui, run, &metrics, anchor, style);
 }
 
 static
@@ -1938,6 +2122,8 @@ b32 gui__key_triggered(const gui_t *gui, u32 key)
 
 static void gui__layer_init(gui_t *gui, gui_layer_t *layer, s32 x, s32 y, s32 w, s32 h);
 static void gui__layer_new(gui_t *gui);
+static gui_frame_metrics_t *gui__frame_metrics_last(gui_t *gui);
+static void gui__frame_metrics_record(gui_t *gui);
 
 gui_t *gui_create(s32 w, s32 h, u32 texture_white, u32 texture_white_dotted,
                   gui_fonts_t fonts, const char *font_file_path)
@@ -1953,6 +2139,24 @@ gui_t *gui_create(s32 w, s32 h, u32 texture_white, u32 texture_white_dotted,
 	gui->texture_white_dotted = texture_white_dotted;
 	gui->fonts = fonts;
 
+	gui->render_alc = g_allocator;
+	gui->verts = NULL;
+	gui->vert_cnt = 0;
+	gui->vert_cap = 0;
+	gui->indices = NULL;
+	gui->index_cnt = 0;
+	gui->index_cap = 0;
+	gui->draw_calls = NULL;
+	gui->draw_call_cnt = 0;
+	gui->draw_call_cap = 0;
+
+	gui->layer_caches = array_create_ex(gui->render_alc);
+	gui->glyph_runs = acalloc(GUI_GLYPH_RUN_CACHE_SETS * GUI__GLYPH_RUN_CACHE_WAYS,
+	                          sizeof(gui__glyph_run_t), gui->render_alc);
+	gui->layer_cache_recording = NULL;
+	gui->layer_cache_active = false;
+	gui->frame_idx = 0;
+
 	memset(gui->prev_keys, 0, KB_COUNT);
 	memset(gui->keys, 0, KB_COUNT);
 	memset(gui->key_toggles, 0, sizeof(gui->key_toggles));
@@ -2032,8 +2236,18 @@ gui_t *gui_create(s32 w, s32 h, u32 texture_white, u32 texture_white_dotted,
 	return gui;
 }
 
+static void gui__layer_cache_destroy(gui__layer_cache_t *cache);
+static void gui__glyph_runs_destroy(gui_t *gui);
+
 void gui_destroy(gui_t *gui)
 {
+	gui__glyph_runs_destroy(gui);
+	array_foreach(gui->layer_caches, gui__layer_cache_t, cache)
+		gui__layer_cache_destroy(cache);
+	array_destroy(gui->layer_caches);
+	afree(gui->verts, gui->render_alc);
+	afree(gui->indices, gui->render_alc);
+	afree(gui->draw_calls, gui->render_alc);
 	afree(gui, g_allocator);
 }
 
@@ -2183,7 +2397,11 @@ void gui_begin_frame(gui_t *gui)
 	const timepoint_t now = timepoint_create();
 
 	gui->frame_time_milli = timepoint_diff_milli(gui->frame_start_time, now);
+	if (gui->frame_metrics_cnt)
+		gui__frame_metrics_last(gui)->frame_micro
+			= timepoint_diff_micro(gui->frame_start_time, now);
 	gui->frame_start_time = now;
+	++gui->frame_idx;
 }
 
 void gui_events_begin(gui_t *gui)
@@ -2370,6 +2588,7 @@ void gui_events_end(gui_t *gui)
 	                gui->window_dim.x, gui->window_dim.y);
 
 	gui->vert_cnt = 0;
+	gui->index_cnt = 0;
 	gui->draw_call_cnt = 0;
 	gui->draw_call_vert_idx = 0;
 	memclr(gui->layers);
@@ -2381,6 +2600,7 @@ void gui_events_end(gui_t *gui)
 
 	gui->culled_draw_calls = 0;
 	gui->culled_vertices   = 0;
+	gui->merged_draw_calls = 0;
 	gui->culled_widgets    = 0;
 
 	/* popup */
@@ -2508,23 +2728,154 @@ b32 gui_begin(gui_t *gui, u32 num_verts, gui_draw_call_type_e type)
 	return gui_begin_tex(gui, num_verts, type, 0, GUI_BLEND_NRM);
 }
 
+static
+u32 gui__buffer_grow_cap(u32 cap, u32 required, u32 chunk_sz)
+{
+	const u32 cap_new = max(required, cap + cap / 2);
+	return ((cap_new + chunk_sz - 1) / chunk_sz) * chunk_sz;
+}
+
+static
+b32 gui__reserve(gui_t *gui, u32 num_verts, u32 num_indices, u32 num_draw_calls)
+{
+	allocator_t *alc = gui->render_alc;
+
+	if (   num_verts > UINT32_MAX - gui->vert_cnt
+	    || num_indices > UINT32_MAX - gui->index_cnt
+	    || num_draw_calls > UINT32_MAX - gui->draw_call_cnt)
+		return false;
+
+	if (gui->vert_cnt + num_verts > gui->vert_cap) {
+		const u32 cap = gui__buffer_grow_cap(gui->vert_cap, gui->vert_cnt + num_verts,
+		                                     GUI_VERT_CHUNK_SZ);
+		gui_vertex_t *verts = arealloc(gui->verts, cap * sizeof(gui_vertex_t), alc);
+		if (!verts)
+			return false;
+		gui->verts = verts;
+		gui->vert_cap = cap;
+	}
+
+	if (gui->index_cnt + num_indices > gui->index_cap) {
+		const u32 cap = gui__buffer_grow_cap(gui->index_cap, gui->index_cnt + num_indices,
+		                                     GUI_VERT_CHUNK_SZ);
+		gui_index_t *indices = arealloc(gui->indices, cap * sizeof(gui_index_t), alc);
+		if (!indices)
+			return false;
+		gui->indices = indices;
+		gui->index_cap = cap;
+	}
+
+	if (gui->draw_call_cnt + num_draw_calls > gui->draw_call_cap) {
+		const u32 cap = gui__buffer_grow_cap(gui->draw_call_cap,
+		                                     gui->draw_call_cnt + num_draw_calls,
+		                                     GUI_DRAW_CALL_CHUNK_SZ);
+		gui_draw_call_t *draw_calls = arealloc(gui->draw_calls,
+		                                       cap * sizeof(gui_draw_call_t), alc);
+		if (!draw_calls)
+			return false;
+		gui->draw_calls = draw_calls;
+		gui->draw_call_cap = cap;
+	}
+
+	return true;
+}
+
+/* Strips, loops & fans can be expressed as lists (lines or triangles) of
+ * their vertices, which lets consecutive draw calls be concatenated. */
+static
+gui_draw_call_type_e gui__draw_call_list_type(gui_draw_call_type_e type)
+{
+	switch (type) {
+	case GUI_DRAW_LINE_STRIP:
+	case GUI_DRAW_LINE_LOOP:
+		return GUI_DRAW_LINES;
+	case GUI_DRAW_TRIANGLE_STRIP:
+	case GUI_DRAW_TRIANGLE_FAN:
+		return GUI_DRAW_TRIANGLES;
+	default:
+		return type;
+	}
+}
+
+static
+u32 gui__draw_call_list_sz(gui_draw_call_type_e type, u32 num_verts)
+{
+	switch (type) {
+	case GUI_DRAW_LINE_STRIP:
+		return num_verts > 1 ? 2 * (num_verts - 1) : 0;
+	case GUI_DRAW_LINE_LOOP:
+		return num_verts > 1 ? 2 * num_verts : 0;
+	case GUI_DRAW_TRIANGLE_STRIP:
+	case GUI_DRAW_TRIANGLE_FAN:
+		return num_verts > 2 ? 3 * (num_verts - 2) : 0;
+	default:
+		return num_verts;
+	}
+}
+
+/* Returns the vertex (relative to the start of the draw call) used by the
+ * i-th element of the list form of the draw call */
+static
+u32 gui__draw_call_list_vert(gui_draw_call_type_e type, u32 num_verts, u32 i)
+{
+	switch (type) {
+	case GUI_DRAW_LINE_STRIP:
+		return i / 2 + i % 2;
+	case GUI_DRAW_LINE_LOOP:
+		return (i / 2 + i % 2) % num_verts;
+	case GUI_DRAW_TRIANGLE_STRIP: {
+		/* alternate the order to preserve the winding of each triangle */
+		const u32 tri = i / 3, corner = i % 3;
+		return corner == 2 ? tri + 2 : tri + (corner + tri) % 2;
+	}
+	case GUI_DRAW_TRIANGLE_FAN:
+		return i % 3 == 0 ? 0 : i / 3 + i % 3;
+	default:
+		return i;
+	}
+}
+
+#ifdef GUI_USE_INDEXED_GEOMETRY
+/* Converts the vertex range of the draw call into an index range */
+static
+void gui__index_draw_call(gui_t *gui, gui_draw_call_t *draw_call)
+{
+	const u32 n = draw_call->cnt;
+	const u32 cnt = gui__draw_call_list_sz(draw_call->type, n);
+	gui_index_t *indices = &gui->indices[gui->index_cnt];
+
+	for (u32 i = 0; i < cnt; ++i)
+		indices[i] = draw_call->idx + gui__draw_call_list_vert(draw_call->type, n, i);
+
+	draw_call->idx  = gui->index_cnt;
+	draw_call->cnt  = cnt;
+	draw_call->type = gui__draw_call_list_type(draw_call->type);
+	gui->index_cnt += cnt;
+}
+#endif // GUI_USE_INDEXED_GEOMETRY
+
 b32 gui_begin_tex(gui_t *gui, u32 num_verts, gui_draw_call_type_e type,
                   u32 tex, gui_blend_e blend)
 {
+	gui_draw_call_t *draw_call;
+#ifdef GUI_USE_INDEXED_GEOMETRY
+	const u32 num_indices = gui__draw_call_list_sz(type, num_verts);
+#else
+	const u32 num_indices = 0;
+#endif
+
 	assert(num_verts > 0);
-	if (   gui->vert_cnt + num_verts <= GUI_MAX_VERTS
-	    && gui->draw_call_cnt < GUI_MAX_DRAW_CALLS) {
-		gui_draw_call_t *draw_call = &gui->draw_calls[gui->draw_call_cnt];
-		draw_call->idx   = gui->vert_cnt;
-		draw_call->cnt   = num_verts;
-		draw_call->type  = type;
-		draw_call->tex   = tex != 0 ? tex : gui->texture_white;
-		draw_call->blend = blend;
-		gui->draw_call_vert_idx = 0;
-		return true;
-	} else {
+	if (!gui__reserve(gui, num_verts, num_indices, 1))
 		return false;
-	}
+
+	draw_call = &gui->draw_calls[gui->draw_call_cnt];
+	draw_call->idx   = gui->vert_cnt;
+	draw_call->cnt   = num_verts;
+	draw_call->type  = type;
+	draw_call->tex   = tex != 0 ? tex : gui->texture_white;
+	draw_call->blend = blend;
+	gui->draw_call_vert_idx = 0;
+	return true;
 }
 
 static
@@ -2533,11 +2884,12 @@ void gui__vertf(gui_t *gui, r32 x, r32 y, color_t c, r32 u, r32 v)
 	const u32 idx_local = gui->draw_call_vert_idx++;
 	const u32 idx       = gui->vert_cnt + idx_local;
 	if (idx_local < (u32)gui->draw_calls[gui->draw_call_cnt].cnt) {
-		gui->verts[idx].x           = x;
-		gui->verts[idx].y           = y;
-		gui->vert_colors[idx]       = c;
-		gui->vert_tex_coords[idx].x = u;
-		gui->vert_tex_coords[idx].y = v;
+		gui_vertex_t *vert = &gui->verts[idx];
+		vert->pos.x       = x;
+		vert->pos.y       = y;
+		vert->tex_coord.x = u;
+		vert->tex_coord.y = v;
+		vert->color       = c;
 	} else {
 		assert(false);
 	}
@@ -2560,8 +2912,12 @@ void gui_vertf(gui_t *gui, r32 x, r32 y, color_t c, r32 u, r32 v)
 
 void gui_end(gui_t *gui)
 {
-	assert(gui->draw_call_vert_idx == gui->draw_calls[gui->draw_call_cnt].cnt);
-	gui->vert_cnt += gui->draw_calls[gui->draw_call_cnt].cnt;
+	gui_draw_call_t *draw_call = &gui->draw_calls[gui->draw_call_cnt];
+	assert(gui->draw_call_vert_idx == draw_call->cnt);
+	gui->vert_cnt += draw_call->cnt;
+#ifdef GUI_USE_INDEXED_GEOMETRY
+	gui__index_draw_call(gui, draw_call);
+#endif
 	++gui->draw_call_cnt;
 	gui->draw_call_vert_idx = 0;
 }
@@ -2602,7 +2958,6 @@ void gui__triangles(gui_t *gui, const v2f *v, u32 n, color_t fill)
 	}
 }
 
-/* NOTE(rgriege): this input vertices may point to the gui.verts output */
 static
 void gui__poly(gui_t *gui, const v2f *v, u32 n, gui_draw_call_type_e type,
                color_t fill, color_t stroke, b32 closed)
@@ -2753,8 +3108,131 @@ void gui__char(gui_t *gui, const gui_char_quad_t *q, color_t color, m3f transfor
 }
 
 static void gui__layer_complete_current(gui_t *gui);
+static void gui__layer_caches_release_unused(gui_t *gui);
 static int gui__layer_sort(const void *lhs, const void *rhs);
 
+static
+b32 gui__draw_calls_mergeable(const gui_draw_call_t *lhs, const gui_draw_call_t *rhs)
+{
+	const gui_draw_call_type_e type = gui__draw_call_list_type(lhs->type);
+	/* degenerate calls would shrink when expanded, which the expansion can't do in place */
+	return lhs->tex == rhs->tex
+	    && lhs->blend == rhs->blend
+	    && type == gui__draw_call_list_type(rhs->type)
+	    && type != GUI_DRAW_QUAD_STRIP
+	    && type != GUI_DRAW_POLYGON
+	    && gui__draw_call_list_sz(lhs->type, lhs->cnt) >= lhs->cnt
+	    && gui__draw_call_list_sz(rhs->type, rhs->cnt) >= rhs->cnt;
+}
+
+#ifndef GUI_USE_INDEXED_GEOMETRY
+/* a call is expanded into a list if it merges with either neighbor */
+static
+b32 gui__draw_call_expands(const gui_draw_call_t *draw_calls, const gui_layer_t *layer, u32 j)
+{
+	const gui_draw_call_t *draw_call = &draw_calls[layer->draw_call_idx + j];
+	return (j > 0 && gui__draw_calls_mergeable(draw_call - 1, draw_call))
+	    || (   j + 1 < layer->draw_call_cnt
+	        && gui__draw_calls_mergeable(draw_call, draw_call + 1));
+}
+
+/* Expands the vertices of mergeable strips/loops/fans into lists in place.
+ * Expanded vertices only move toward the end of the buffer & never read a vertex
+ * ahead of the one being written, so the calls are rewritten back to front,
+ * stopping at the first expanded call. */
+static
+b32 gui__expand_draw_calls(gui_t *gui)
+{
+	const u32 n_layers = gui_num_layers(gui);
+	u32 vert_cnt = 0, expanded = 0;
+
+	for (u32 i = 0; i < n_layers; ++i) {
+		const gui_layer_t *layer = &gui->layers[i];
+		for (u32 j = 0; j < layer->draw_call_cnt; ++j) {
+			const gui_draw_call_t *draw_call = &gui->draw_calls[layer->draw_call_idx + j];
+			if (gui__draw_call_expands(gui->draw_calls, layer, j)) {
+				vert_cnt += gui__draw_call_list_sz(draw_call->type, draw_call->cnt);
+				++expanded;
+			} else {
+				vert_cnt += draw_call->cnt;
+			}
+		}
+	}
+
+	if (expanded == 0)
+		return false;
+	assert(vert_cnt >= gui->vert_cnt);
+	if (!gui__reserve(gui, vert_cnt - gui->vert_cnt, 0, 0))
+		return false;
+
+	gui->vert_cnt = vert_cnt;
+	for (u32 i = n_layers; i-- > 0 && expanded > 0; ) {
+		const gui_layer_t *layer = &gui->layers[i];
+		for (u32 j = layer->draw_call_cnt; j-- > 0 && expanded > 0; ) {
+			/* an expanded neighbor still has the same list type */
+			gui_draw_call_t *draw_call = &gui->draw_calls[layer->draw_call_idx + j];
+			const b32 expand = gui__draw_call_expands(gui->draw_calls, layer, j);
+			const u32 cnt = expand
+			              ? gui__draw_call_list_sz(draw_call->type, draw_call->cnt)
+			              : draw_call->cnt;
+			const u32 dst = vert_cnt - cnt;
+
+			assert(dst >= draw_call->idx);
+			if (expand) {
+				for (u32 k = cnt; k-- > 0; ) {
+					const u32 src = gui__draw_call_list_vert(draw_call->type, draw_call->cnt, k);
+					gui->verts[dst + k] = gui->verts[draw_call->idx + src];
+				}
+				draw_call->type = gui__draw_call_list_type(draw_call->type);
+				--expanded;
+			} else if (dst != draw_call->idx) {
+				memmove(&gui->verts[dst], &gui->verts[draw_call->idx],
+				        cnt * sizeof(gui_vertex_t));
+			}
+			draw_call->idx = dst;
+			draw_call->cnt = cnt;
+			vert_cnt = dst;
+		}
+	}
+	return true;
+}
+#endif // GUI_USE_INDEXED_GEOMETRY
+
+/* Coalesces consecutive draw calls within each layer that share a texture,
+ * blend mode & list type.  Without indices, strips/loops/fans that get merged
+ * are first expanded into lists, so merged calls are contiguous. */
+static
+void gui__merge_draw_calls(gui_t *gui)
+{
+	const u32 n_layers = gui_num_layers(gui);
+	gui_draw_call_t *draw_calls;
+	u32 draw_call_cnt = 0;
+
+#ifndef GUI_USE_INDEXED_GEOMETRY
+	if (!gui__expand_draw_calls(gui))
+		return;
+#endif
+	draw_calls = gui->draw_calls;
+
+	for (u32 i = 0; i < n_layers; ++i) {
+		gui_layer_t *layer = &gui->layers[i];
+		const u32 layer_draw_call_idx = draw_call_cnt;
+		for (u32 j = 0; j < layer->draw_call_cnt; ++j) {
+			const gui_draw_call_t draw_call = draw_calls[layer->draw_call_idx + j];
+			if (   j > 0
+			    && gui__draw_calls_mergeable(&draw_calls[draw_call_cnt - 1], &draw_call)) {
+				draw_calls[draw_call_cnt - 1].cnt += draw_call.cnt;
+				++gui->merged_draw_calls;
+			} else {
+				draw_calls[draw_call_cnt++] = draw_call;
+			}
+		}
+		layer->draw_call_idx = layer_draw_call_idx;
+		layer->draw_call_cnt = draw_call_cnt - layer_draw_call_idx;
+	}
+	gui->draw_call_cnt = draw_call_cnt;
+}
+
 void gui_end_frame(gui_t *gui)
 {
 	assert(gui->grid == NULL);
@@ -2767,12 +3245,18 @@ void gui_end_frame(gui_t *gui)
 
 	gui__layer_complete_current(gui);
 
+	gui__layer_caches_release_unused(gui);
+
+	gui__merge_draw_calls(gui);
+
 	const u32 n_layers = gui_num_layers(gui);
 	/* move hints/popups to the back of the array
 	 * can't use qsort - not guaranteed to be stable */
 	isort(gui->layers, n_layers, sizeof(gui->layers[0]), gui__layer_sort);
 	/* front-to-back -> back-to-front */
 	reverse(gui->layers, sizeof(gui->layers[0]), n_layers);
+
+	gui__frame_metrics_record(gui);
 }
 
 void gui_end_frame_ex(gui_t *gui, u32 target_frame_milli,
@@ -3264,21 +3748,19 @@ void gui_arc(gui_t *gui, s32 x, s32 y, r32 r, r32 angle_start, r32 angle_end,
              color_t fill, color_t stroke)
 {
 	const u32 num_verts = gui__arc_poly_sz(r, angle_start, angle_end);
-	if (gui->vert_cnt + num_verts <= GUI_MAX_VERTS) {
-		v2f *verts = &gui->verts[gui->vert_cnt];
-		arc_to_poly(x, y, r, angle_start, angle_end, verts, num_verts, false);
-		gui__poly(gui, verts, num_verts, GUI_DRAW_TRIANGLE_FAN, fill, stroke, false);
-	}
+	v2f *verts = amalloc(num_verts * sizeof(v2f), g_temp_allocator);
+	arc_to_poly(x, y, r, angle_start, angle_end, verts, num_verts, false);
+	gui__poly(gui, verts, num_verts, GUI_DRAW_TRIANGLE_FAN, fill, stroke, false);
+	afree(verts, g_temp_allocator);
 }
 
 void gui_circ(gui_t *gui, s32 x, s32 y, s32 r, color_t fill, color_t stroke)
 {
 	const u32 num_verts = gui__arc_poly_sz(r, 0, fPI * 2.f);
-	if (gui->vert_cnt + num_verts <= GUI_MAX_VERTS) {
-		v2f *verts = &gui->verts[gui->vert_cnt];
-		arc_to_poly(x, y, r, 0, fPI * 2.f, verts, num_verts, true);
-		gui__poly(gui, verts, num_verts, GUI_DRAW_TRIANGLE_FAN, fill, stroke, true);
-	}
+	v2f *verts = amalloc(num_verts * sizeof(v2f), g_temp_allocator);
+	arc_to_poly(x, y, r, 0, fPI * 2.f, verts, num_verts, true);
+	gui__poly(gui, verts, num_verts, GUI_DRAW_TRIANGLE_FAN, fill, stroke, true);
+	afree(verts, g_temp_allocator);
 }
 
 void gui_trisf(gui_t *gui, const v2f *v, u32 n, color_t fill)
@@ -3288,14 +3770,13 @@ void gui_trisf(gui_t *gui, const v2f *v, u32 n, color_t fill)
 
 void gui_poly(gui_t *gui, const v2i *v, u32 n, color_t fill, color_t stroke)
 {
-	if (gui->vert_cnt + n <= GUI_MAX_VERTS) {
-		v2f *verts = &gui->verts[gui->vert_cnt];
-		for (u32 i = 0; i < n; ++i) {
-			verts[i].x = v[i].x;
-			verts[i].y = v[i].y;
-		}
-		gui_polyf(gui, verts, n, fill, stroke);
+	v2f *verts = amalloc(n * sizeof(v2f), g_temp_allocator);
+	for (u32 i = 0; i < n; ++i) {
+		verts[i].x = v[i].x;
+		verts[i].y = v[i].y;
 	}
+	gui_polyf(gui, verts, n, fill, stroke);
+	afree(verts, g_temp_allocator);
 }
 
 void gui_polyf(gui_t *gui, const v2f *v, u32 n, color_t fill, color_t stroke)
@@ -3303,12 +3784,11 @@ void gui_polyf(gui_t *gui, const v2f *v, u32 n, color_t fill, color_t stroke)
 	if (n == 3 || fill.a == 0 || polyf_is_convex(v, n)) {
 		gui__poly(gui, v, n, GUI_DRAW_TRIANGLE_FAN, fill, stroke, true);
 	} else {
-		if (gui->vert_cnt + triangulate_reserve_sz(n) <= GUI_MAX_VERTS) {
-			v2f *verts = &gui->verts[gui->vert_cnt];
-			u32 n_verts = 0;
-			if (triangulate(v, n, verts, &n_verts))
-				gui__triangles(gui, verts, n_verts, fill);
-		}
+		v2f *verts = amalloc(triangulate_reserve_sz(n) * sizeof(v2f), g_temp_allocator);
+		u32 n_verts = 0;
+		if (triangulate(v, n, verts, &n_verts))
+			gui__triangles(gui, verts, n_verts, fill);
+		afree(verts, g_temp_allocator);
 		if (stroke.a != 0)
 			gui__poly(gui, v, n, GUI_DRAW_TRIANGLE_FAN, g_nocolor, stroke, true);
 	}
@@ -3335,14 +3815,13 @@ void gui__polyline_corner_offset(v2f a, v2f b, v2f c, r32 d, v2f *p)
 
 void gui_polyline(gui_t *gui, const v2i *v, u32 n, color_t stroke)
 {
-	if (gui->vert_cnt + n <= GUI_MAX_VERTS) {
-		v2f *verts = &gui->verts[gui->vert_cnt];
-		for (u32 i = 0; i < n; ++i) {
-			verts[i].x = v[i].x;
-			verts[i].y = v[i].y;
-		}
-		gui__poly(gui, verts, n, GUI_DRAW_TRIANGLE_FAN, g_nocolor, stroke, false);
+	v2f *verts = amalloc(n * sizeof(v2f), g_temp_allocator);
+	for (u32 i = 0; i < n; ++i) {
+		verts[i].x = v[i].x;
+		verts[i].y = v[i].y;
 	}
+	gui__poly(gui, verts, n, GUI_DRAW_TRIANGLE_FAN, g_nocolor, stroke, false);
+	afree(verts, g_temp_allocator);
 }
 
 void gui_polylinef(gui_t *gui, const v2f *v, u32 n, r32 w, color_t stroke)
@@ -3350,13 +3829,13 @@ void gui_polylinef(gui_t *gui, const v2f *v, u32 n, r32 w, color_t stroke)
 	assert(n >= 2 && w >= 1.f);
 	if (w == 1.f) {
 		gui__poly(gui, v, n, GUI_DRAW_TRIANGLE_FAN, g_nocolor, stroke, false);
-	} else if (gui->vert_cnt + 2*n <= GUI_MAX_VERTS) {
+	} else {
 		const r32 w2    = w / 2.f;
 		const v2f dir0  = v2f_scale(v2f_dir(v[0], v[1]), w2);
 		const v2f perp0 = v2f_lperp(dir0);
 		const v2f dirn  = v2f_scale(v2f_dir(v[n-2], v[n-1]), w2);
 		const v2f perpn = v2f_lperp(dirn);
-		v2f *verts = &gui->verts[gui->vert_cnt];
+		v2f *verts = amalloc(2 * n * sizeof(v2f), g_temp_allocator);
 
 		verts[0] = v2f_add(v2f_sub(v[0], dir0), perp0);
 		verts[1] = v2f_sub(v2f_sub(v[0], dir0), perp0);
@@ -3370,6 +3849,7 @@ void gui_polylinef(gui_t *gui, const v2f *v, u32 n, r32 w, color_t stroke)
 		verts[2*n-1] = v2f_sub(v2f_add(v[n-1], dirn), perpn);
 
 		gui__poly(gui, verts, 2*n, GUI_DRAW_TRIANGLE_STRIP, stroke, g_nocolor, true);
+		afree(verts, g_temp_allocator);
 	}
 }
 
@@ -3480,15 +3960,14 @@ void gui__txt_get_cursor_pos(gui_t *gui, s32 x, s32 y, s32 w, s32 h,
 {
 	void *font;
 	gui_font_metrics_t font_metrics;
+	const gui__glyph_run_t *run;
 	v2i anchor;
 	v2f pos;
-	gui_char_quad_t q;
+	r32 line_x;
+	u32 line = 0;
 	str_t wrapped = NULL;
 	const s32 size = gui_scale_val(gui, style->size);
 	const char *display = txt;
-	const char *p, *target;
-	char *pnext;
-	s32 cp;
 
 	font = gui->fonts.get_font(gui->fonts.handle, gui->style.font_path, size);
 	if (!font)
@@ -3502,22 +3981,24 @@ void gui__txt_get_cursor_pos(gui_t *gui, s32 x, s32 y, s32 w, s32 h,
 		display = wrapped;
 	}
 
+	run = gui__glyph_run(gui, font, size, display);
 	gui_align_anchor(x, y, w, h, style->align, &anchor.x, &anchor.y);
-	pos = gui__txt_start_pos(gui, display, anchor, style);
+	pos = gui__glyph_run_start_pos(gui, run, &font_metrics, anchor, style);
+	line_x = pos.x;
 
 	if (cursor == 0)
 		goto out;
 
-	p = display;
-	target = &display[cursor];
-	while (p < target && (cp = utf8_next_codepoint(p, &pnext)) != 0) {
-		if (cp == '\n') {
+	array_foreach(run->glyphs, const gui__glyph_t, glyph) {
+		if (glyph->offset >= cursor)
+			break;
+		if (glyph->newline) {
 			pos.y -= font_metrics.newline_dist;
-			pos.x = anchor.x + gui__txt_line_offset_x(gui, pnext, style);
-		} else if (gui->fonts.get_char_quad(font, cp, pos.x, pos.y, &q)) {
-			pos.x += q.advance;
+			line_x = gui__glyph_run_line_x(gui, run, ++line, anchor, style);
+			pos.x = line_x;
+		} else {
+			pos.x = line_x + glyph->x + glyph->quad.advance;
 		}
-		p = pnext;
 	}
 
 out:
@@ -3535,12 +4016,11 @@ void gui__txt_sequence(gui_t *gui, v2i anchor, r32 x0, r32 y0,
 {
 	void *font;
 	gui_font_metrics_t font_metrics;
-	r32 x = x0, y = y0;
+	const gui__glyph_run_t *run;
+	r32 x = x0, y = y0, line_x = x0;
+	u32 line = 0;
 	gui_char_quad_t q;
 	const s32 size = gui_scale_val(gui, style->size);
-	const char *p = txt;
-	char *pnext;
-	s32 cp;
 
 	font = gui->fonts.get_font(gui->fonts.handle, gui->style.font_path, size);
 	if (!font)
@@ -3554,15 +4034,19 @@ void gui__txt_sequence(gui_t *gui, v2i anchor, r32 x0, r32 y0,
 	transform = m3f_mul_m3(transform, m3f_init_rotation(style->rotation));
 	transform = m3f_mul_m3(transform, m3f_init_translation(v2f_inverse(anchorf)));
 
-	while (p - txt < max_len && (cp = utf8_next_codepoint(p, &pnext)) != 0) {
-		if (cp == '\n') {
+	run = gui__glyph_run(gui, font, size, txt);
+	array_foreach(run->glyphs, const gui__glyph_t, glyph) {
+		if (glyph->offset >= max_len)
+			break;
+		if (glyph->newline) {
 			y -= font_metrics.newline_dist;
-			x = anchor.x + gui__txt_line_offset_x(gui, pnext, style);
-		} else if (gui->fonts.get_char_quad(font, cp, x, y, &q)) {
+			line_x = gui__glyph_run_line_x(gui, run, ++line, anchor, style);
+			x = line_x;
+		} else {
+			q = gui__glyph_quad(glyph, line_x, y);
 			gui__char(gui, &q, style->color, transform);
-			x += q.advance;
+			x = line_x + glyph->x + glyph->quad.advance;
 		}
-		p = pnext;
 	}
 out:
 	*x1 = x;
@@ -3586,18 +4070,17 @@ u32 gui__txt_get_cursor_at_pos(gui_t *gui, s32 x, s32 y, s32 w, s32 h,
 {
 	void *font;
 	gui_font_metrics_t font_metrics;
+	const gui__glyph_run_t *run;
 	v2i anchor;
 	v2f pos;
-	gui_char_quad_t q;
+	r32 line_x;
+	u32 line = 0;
 	u32 closest_pos;
 	s32 closest_dist, dist;
 	v2i pp;
 	str_t wrapped = NULL;
 	const s32 size = gui_scale_val(gui, style->size);
 	const char *display = txt;
-	const char *p;
-	char *pnext;
-	s32 cp;
 
 	if (style->wrap) {
 		wrapped = str_dup(txt, g_temp_allocator);
@@ -3611,29 +4094,28 @@ u32 gui__txt_get_cursor_at_pos(gui_t *gui, s32 x, s32 y, s32 w, s32 h,
 
 	gui->fonts.get_metrics(font, &font_metrics);
 
+	run = gui__glyph_run(gui, font, size, display);
 	gui_align_anchor(x, y, w, h, style->align, &anchor.x, &anchor.y);
-	pos = gui__txt_start_pos(gui, display, anchor, style);
+	pos = gui__glyph_run_start_pos(gui, run, &font_metrics, anchor, style);
+	line_x = pos.x;
 
 	v2i_set(&pp, pos.x, pos.y + font_metrics.ascent / 2);
 	closest_pos = 0;
 	closest_dist = v2i_dist_sq(pp, mouse);
 
-	p = display;
-	while ((cp = utf8_next_codepoint(p, &pnext)) != 0) {
-		p = pnext;
-		if (cp == '\n') {
+	array_foreach(run->glyphs, const gui__glyph_t, glyph) {
+		if (glyph->newline) {
 			pos.y -= font_metrics.newline_dist;
-			pos.x = anchor.x + gui__txt_line_offset_x(gui, p, style);
-		} else if (gui->fonts.get_char_quad(font, cp, pos.x, pos.y, &q)) {
-			pos.x += q.advance;
+			line_x = gui__glyph_run_line_x(gui, run, ++line, anchor, style);
+			pos.x = line_x;
 		} else {
-			continue;
+			pos.x = line_x + glyph->x + glyph->quad.advance;
 		}
 		v2i_set(&pp, roundf(pos.x), roundf(pos.y + font_metrics.ascent / 2));
 		dist = v2i_dist_sq(pp, mouse);
 		if (dist < closest_dist) {
 			closest_dist = dist;
-			closest_pos = (u32)(p - display);
+			closest_pos = glyph->end;
 		}
 	}
 	if (wrapped)
@@ -3665,11 +4147,11 @@ void gui_txt_dim(const gui_t *gui, s32 x, s32 y, s32 size_, const char *txt,
                  gui_align_e align, s32 *px, s32 *py, s32 *pw, s32 *ph)
 {
 	const v2i anchor = { x, y };
-	const char *p = txt;
-	char *pnext;
-	s32 cp;
 	void *font;
+	const gui__glyph_run_t *run;
 	v2f pos;
+	r32 line_x;
+	u32 line = 0;
 	ivalf x_range, y_range;
 	gui_char_quad_t q;
 	const s32 size = gui_scale_val(gui, size_);
@@ -3694,23 +4176,24 @@ void gui_txt_dim(const gui_t *gui, s32 x, s32 y, s32 size_, const char *txt,
 
 	gui->fonts.get_metrics(font, &font_metrics);
 
-	pos = gui__txt_start_pos(gui, txt, anchor, &style);
+	run = gui__glyph_run(gui, font, size, txt);
+	pos = gui__glyph_run_start_pos(gui, run, &font_metrics, anchor, &style);
+	line_x = pos.x;
 
 	x_range.l = x_range.r = pos.x;
 	y_range.l = y_range.r = pos.y;
 
-	while ((cp = utf8_next_codepoint(p, &pnext)) != 0) {
-		if (cp == '\n') {
+	array_foreach(run->glyphs, const gui__glyph_t, glyph) {
+		if (glyph->newline) {
 			pos.y -= font_metrics.newline_dist;
-			pos.x = anchor.x + gui__txt_line_offset_x(gui, pnext, &style);
-		} else if (gui->fonts.get_char_quad(font, cp, pos.x, pos.y, &q)) {
+			line_x = gui__glyph_run_line_x(gui, run, ++line, anchor, &style);
+		} else {
+			q = gui__glyph_quad(glyph, line_x, pos.y);
 			x_range.l = min(x_range.l, q.x0);
 			x_range.r = max(x_range.r, q.x1);
 			y_range.l = min(y_range.l, q.y0);
 			y_range.r = max(y_range.r, q.y1);
-			pos.x += q.advance;
 		}
-		p = pnext;
 	}
 	*px = x_range.l;
 	*py = y_range.l;
@@ -3718,22 +4201,19 @@ void gui_txt_dim(const gui_t *gui, s32 x, s32 y, s32 size_, const char *txt,
 	*ph = ivalf_length(y_range);
 }
 
-s32 gui_txt_width(const gui_t *gui, const char *txt, s32 size)
+s32 gui_txt_width(const gui_t *gui, const char *txt, s32 size_)
 {
-	const char *p = txt;
-	char *pnext;
+	const s32 size = gui_scale_val(gui, size_);
+	void *font = gui->fonts.get_font(gui->fonts.handle, gui->style.font_path, size);
+	const gui__glyph_run_t *run;
 	s32 width = 0;
-	s32 line_width;
-	s32 cp;
 
-	while (*p != 0) {
-		line_width = gui__txt_line_width(gui, p, size);
-		width = max(width, line_width);
-		while ((cp = utf8_next_codepoint(p, &pnext)) != 0 && cp != '\n')
-			p = pnext;
-		if (cp == '\n')
-			p = pnext;
-	}
+	if (!font)
+		return 0;
+
+	run = gui__glyph_run(gui, font, size, txt);
+	array_foreach(run->line_widths, const s32, line_width)
+		width = max(width, *line_width);
 	return width;
 }
 
@@ -3804,6 +4284,170 @@ void gui_mask_pop(gui_t *gui)
 	gui__layer_new(gui);
 }
 
+static
+void gui__layer_cache_destroy(gui__layer_cache_t *cache)
+{
+	array_destroy(cache->verts);
+	array_destroy(cache->indices);
+	array_destroy(cache->draw_calls);
+}
+
+static
+gui__layer_cache_t *gui__layer_cache_find(gui_t *gui, u64 id)
+{
+	array_foreach(gui->layer_caches, gui__layer_cache_t, cache)
+		if (cache->id == id)
+			return cache;
+	return NULL;
+}
+
+static
+void gui__layer_cache_replay(gui_t *gui, const gui__layer_cache_t *cache)
+{
+	const u32 vert_base = gui->vert_cnt;
+	const u32 index_base = gui->index_cnt;
+	const u32 num_verts = array_sz(cache->verts);
+	const u32 num_indices = array_sz(cache->indices);
+	const u32 num_draw_calls = array_sz(cache->draw_calls);
+
+	box2i_extend_box(&gui->widget_bounds->children, cache->bbox);
+
+	if (!gui__reserve(gui, num_verts, num_indices, num_draw_calls))
+		return;
+
+	/* recorded offsets are relative to the start of the cache */
+	memcpy(&gui->verts[vert_base], cache->verts, num_verts * sizeof(gui_vertex_t));
+	for (u32 i = 0; i < num_indices; ++i)
+		gui->indices[index_base + i] = cache->indices[i] + vert_base;
+	for (u32 i = 0; i < num_draw_calls; ++i) {
+		gui_draw_call_t *draw_call = &gui->draw_calls[gui->draw_call_cnt + i];
+		*draw_call = cache->draw_calls[i];
+#ifdef GUI_USE_INDEXED_GEOMETRY
+		draw_call->idx += index_base;
+#else
+		draw_call->idx += vert_base;
+#endif
+	}
+
+	gui->vert_cnt += num_verts;
+	gui->index_cnt += num_indices;
+	gui->draw_call_cnt += num_draw_calls;
+}
+
+static
+void gui__layer_cache_record(gui_t *gui, gui__layer_cache_t *cache)
+{
+	const u32 vert_base = gui->layer_cache_vert_idx;
+	const u32 index_base = gui->layer_cache_index_idx;
+	const u32 num_verts = gui->vert_cnt - vert_base;
+	const u32 num_indices = gui->index_cnt - index_base;
+	const u32 num_draw_calls = gui->draw_call_cnt - gui->layer_cache_draw_call_idx;
+
+	array_clear(cache->verts);
+	array_clear(cache->indices);
+	array_clear(cache->draw_calls);
+	array_appendn(cache->verts, &gui->verts[vert_base], num_verts);
+	for (u32 i = 0; i < num_indices; ++i)
+		array_append(cache->indices, gui->indices[index_base + i] - vert_base);
+	for (u32 i = 0; i < num_draw_calls; ++i) {
+		gui_draw_call_t draw_call = gui->draw_calls[gui->layer_cache_draw_call_idx + i];
+#ifdef GUI_USE_INDEXED_GEOMETRY
+		draw_call.idx -= index_base;
+#else
+		draw_call.idx -= vert_base;
+#endif
+		array_append(cache->draw_calls, draw_call);
+	}
+
+	box2i_from_xywh(&cache->bbox, cache->mask.min.x, cache->mask.min.y, 0, 0);
+	for (u32 i = 0; i < num_verts; ++i) {
+		const v2i p = { (s32)cache->verts[i].pos.x, (s32)cache->verts[i].pos.y };
+		if (i == 0)
+			cache->bbox.min = cache->bbox.max = p;
+		else
+			box2i_extend_point(&cache->bbox, p);
+	}
+	cache->valid = true;
+}
+
+b32 gui_layer_cache_begin(gui_t *gui, u64 id, u32 hash, s32 x, s32 y, s32 w, s32 h)
+{
+	gui__layer_cache_t *cache = gui__layer_cache_find(gui, id);
+	box2i mask;
+
+	assert(!gui->layer_cache_active);
+
+	box2i_from_xywh(&mask, x, y, w, h);
+	gui_mask_push(gui, x, y, w, h);
+	gui->layer_cache_active = true;
+
+	if (!cache) {
+		cache = array_append_null(gui->layer_caches);
+		cache->id = id;
+		cache->valid = false;
+		cache->verts = array_create_ex(gui->render_alc);
+		cache->indices = array_create_ex(gui->render_alc);
+		cache->draw_calls = array_create_ex(gui->render_alc);
+	}
+	cache->last_frame = gui->frame_idx;
+
+	if (   cache->valid
+	    && cache->hash == hash
+	    && box2i_eq(cache->mask, mask)) {
+		gui__layer_cache_replay(gui, cache);
+		gui->layer_cache_recording = NULL;
+		return false;
+	}
+
+	cache->hash = hash;
+	cache->mask = mask;
+	cache->valid = false;
+	gui->layer_cache_recording = cache;
+	gui->layer_cache_vert_idx = gui->vert_cnt;
+	gui->layer_cache_index_idx = gui->index_cnt;
+	gui->layer_cache_draw_call_idx = gui->draw_call_cnt;
+	return true;
+}
+
+void gui_layer_cache_end(gui_t *gui)
+{
+	gui__layer_cache_t *cache = gui->layer_cache_recording;
+
+	assert(gui->layer_cache_active);
+
+	if (cache) {
+		/* content spanning several layers can't be replayed as one */
+		if (gui->layer->draw_call_idx == gui->layer_cache_draw_call_idx)
+			gui__layer_cache_record(gui, cache);
+		else
+			log_warn("layer cache %llu not recorded: content pushed a mask",
+			         (unsigned long long)cache->id);
+	}
+
+	gui->layer_cache_recording = NULL;
+	gui->layer_cache_active = false;
+	gui_mask_pop(gui);
+}
+
+void gui_layer_cache_invalidate(gui_t *gui, u64 id)
+{
+	gui__layer_cache_t *cache = gui__layer_cache_find(gui, id);
+	if (cache)
+		cache->valid = false;
+}
+
+static
+void gui__layer_caches_release_unused(gui_t *gui)
+{
+	for (u32 i = array_sz(gui->layer_caches); i > 0; --i) {
+		gui__layer_cache_t *cache = &gui->layer_caches[i-1];
+		if (cache->last_frame != gui->frame_idx) {
+			gui__layer_cache_destroy(cache);
+			array_remove_fast(gui->layer_caches, i-1);
+		}
+	}
+}
+
 static
 int gui__layer_sort(const void *lhs_, const void *rhs_)
 {
@@ -3940,6 +4584,11 @@ u32 gui_vert_cnt(const gui_t *gui)
 	return gui->vert_cnt;
 }
 
+u32 gui_index_cnt(const gui_t *gui)
+{
+	return gui->index_cnt;
+}
+
 u32 gui_draw_call_cnt(const gui_t *gui)
 {
 	return gui->draw_call_cnt;
@@ -3960,20 +4609,142 @@ u32 gui_culled_widget_cnt(const gui_t *gui)
 	return gui->culled_widgets;
 }
 
+u32 gui_merged_draw_call_cnt(const gui_t *gui)
+{
+	return gui->merged_draw_calls;
+}
+
 void gui_get_render_output(const gui_t *gui, gui_render_output_t *output)
 {
 	output->num_layers = gui_num_layers(gui);
 	output->layers = gui->layers;
 
 	output->num_verts = gui->vert_cnt;
-	output->verts.pos = gui->verts;
-	output->verts.color = gui->vert_colors;
-	output->verts.tex_coord = gui->vert_tex_coords;
+	output->verts = gui->verts;
+
+#ifdef GUI_USE_INDEXED_GEOMETRY
+	output->num_indices = gui->index_cnt;
+	output->indices = gui->indices;
+#else
+	output->num_indices = 0;
+	output->indices = NULL;
+#endif
 
 	output->num_draw_calls = gui->draw_call_cnt;
 	output->draw_calls = gui->draw_calls;
 }
 
+static
+gui_frame_metrics_t *gui__frame_metrics_last(gui_t *gui)
+{
+	assert(gui->frame_metrics_cnt > 0);
+	return &gui->frame_metrics[(gui->frame_metrics_cnt - 1) % GUI_FRAME_METRICS_CAPACITY];
+}
+
+static
+void gui__frame_metrics_record(gui_t *gui)
+{
+	gui_frame_metrics_t *metrics
+		= &gui->frame_metrics[gui->frame_metrics_cnt % GUI_FRAME_METRICS_CAPACITY];
+	size_t temp_bytes = 0, temp_pages, temp_bytes_available, temp_pages_available;
+
+	if (g_temp_allocator)
+		pgb_stats(g_temp_allocator->udata, &temp_bytes, &temp_pages,
+		          &temp_bytes_available, &temp_pages_available);
+
+	metrics->frame_micro       = 0;
+	metrics->build_micro       = timepoint_diff_micro(gui->frame_start_time, timepoint_create());
+	metrics->submit_micro      = 0;
+	metrics->verts             = gui->vert_cnt;
+	metrics->draw_calls        = gui->draw_call_cnt;
+	metrics->culled_verts      = gui->culled_vertices;
+	metrics->culled_draw_calls = gui->culled_draw_calls;
+	metrics->culled_widgets    = gui->culled_widgets;
+	metrics->temp_bytes        = (u32)min(temp_bytes, (size_t)UINT_MAX);
+	++gui->frame_metrics_cnt;
+}
+
+void gui_frame_metrics_set_submit_micro(gui_t *gui, u32 submit_micro)
+{
+	if (gui->frame_metrics_cnt)
+		gui__frame_metrics_last(gui)->submit_micro = submit_micro;
+}
+
+u32 gui_frame_metrics_cnt(const gui_t *gui)
+{
+	return min(gui->frame_metrics_cnt, GUI_FRAME_METRICS_CAPACITY);
+}
+
+const gui_frame_metrics_t *gui_frame_metrics(const gui_t *gui, u32 frames_ago)
+{
+	if (frames_ago >= gui_frame_metrics_cnt(gui))
+		return NULL;
+	return &gui->frame_metrics[(gui->frame_metrics_cnt - 1 - frames_ago)
+	                           % GUI_FRAME_METRICS_CAPACITY];
+}
+
+void gui_frame_metrics_overlay(gui_t *gui, s32 x, s32 y, s32 w, s32 h)
+{
+	const gui_element_style_t *style = &gui->style.hint;
+	const s32 padding = gui_scale_val(gui, style->text.padding);
+	const s32 line_h = style->text.size + padding;
+	const s32 gx = x + padding, gy = y + padding;
+	const s32 gw = w - 2 * padding, gh = h - 2 * padding - 2 * line_h;
+	const s32 bar_w = max(gw / GUI_FRAME_METRICS_CAPACITY, 1);
+	const u32 bar_cnt = min(gui_frame_metrics_cnt(gui), (u32)max(gw / bar_w, 0));
+	const gui_frame_metrics_t *last = gui_frame_metrics(gui, 0);
+	gui_widget_bounds_t bounds = {0};
+	u32 max_micro = GUI_FRAME_METRICS_TARGET_MICRO, worst_micro = 0;
+
+	gui_mask_push(gui, x, y, w, h);
+	box2i_from_xywh(&bounds.bbox, x, y, w, h);
+	gui_widget_bounds_push(gui, &bounds, false);
+	gui->layer->pri = GUI__LAYER_PRIORITY_OVERLAY;
+	gui_rect(gui, x, y, w, h, style->bg_color, style->outline_color);
+
+	for (u32 i = 0; i < bar_cnt; ++i) {
+		const gui_frame_metrics_t *metrics = gui_frame_metrics(gui, i);
+		worst_micro = max(worst_micro, metrics->build_micro + metrics->submit_micro);
+	}
+	max_micro = max(max_micro, worst_micro);
+
+	/* newest frame on the right, submit time stacked on build time */
+	for (u32 i = 0; i < bar_cnt && gh > 0; ++i) {
+		const gui_frame_metrics_t *metrics = gui_frame_metrics(gui, i);
+		const s32 bx = gx + gw - (s32)(i + 1) * bar_w;
+		const s32 build_h  = (s32)((u64)metrics->build_micro * gh / max_micro);
+		const s32 submit_h = (s32)((u64)metrics->submit_micro * gh / max_micro);
+		if (build_h > 0)
+			gui_rect(gui, bx, gy, bar_w, build_h, g_lightblue, g_nocolor);
+		if (submit_h > 0)
+			gui_rect(gui, bx, gy + build_h, bar_w, submit_h, g_orange, g_nocolor);
+	}
+	if (gh > 0) {
+		const s32 target_y = gy + (s32)((u64)GUI_FRAME_METRICS_TARGET_MICRO * gh / max_micro);
+		gui_line(gui, gx, target_y, gx + gw, target_y, 1, g_medred);
+	}
+
+	if (last) {
+		const u32 cpu_micro = last->build_micro + last->submit_micro;
+		gui_txt(gui, gx, y + h - padding, style->text.size,
+		        imprintf("cpu %u.%02u ms (build %u.%02u + submit %u.%02u), worst %u.%02u ms",
+		                 cpu_micro / 1000, cpu_micro % 1000 / 10,
+		                 last->build_micro / 1000, last->build_micro % 1000 / 10,
+		                 last->submit_micro / 1000, last->submit_micro % 1000 / 10,
+		                 worst_micro / 1000, worst_micro % 1000 / 10),
+		        style->text.color, GUI_ALIGN_TOPLEFT);
+		gui_txt(gui, gx, y + h - padding - line_h, style->text.size,
+		        imprintf("%u verts, %u draws, culled %u verts / %u draws / %u widgets, temp %u KB",
+		                 last->verts, last->draw_calls, last->culled_verts,
+		                 last->culled_draw_calls, last->culled_widgets,
+		                 last->temp_bytes / 1024),
+		        style->text.color, GUI_ALIGN_TOPLEFT);
+	}
+
+	gui_widget_bounds_pop(gui, &bounds, false);
+	gui_mask_pop(gui);
+}
+
 const gui_npt_filter_t g_gui_npt_filter_print = {
 	.ascii = {
 		0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
@@ -4323,15 +5094,13 @@ void gui__npt_txt(gui_t *gui, s32 x, s32 y, s32 w, s32 h,
 	gui_font_metrics_t metrics;
 	gui_text_style_t style_inverse = *style;
 	str_t wrapped = NULL;
+	const gui__glyph_run_t *run;
 	u32 beg, end;
 	v2i anchor;
 	v2f pos;
-	s32 cp;
-	const char *p;
-	char *pnext;
+	u32 line = 0;
 	r32 rx, ry, rh;
-	b32 inside_selection;
-	gui_char_quad_t q;
+	b32 inside_selection, reached_beg, reached_end;
 	const char *txt0, *txt1, *txt2;
 	u32 len0, len1, len2;
 
@@ -4354,33 +5123,33 @@ void gui__npt_txt(gui_t *gui, s32 x, s32 y, s32 w, s32 h,
 	}
 
 	/* render the selection background(s) */
+	run = gui__glyph_run(gui, font, size, display);
 	gui_align_anchor(x, y, w, h, style->align, &anchor.x, &anchor.y);
-	pos = gui__txt_start_pos(gui, display, anchor, style);
+	pos = gui__glyph_run_start_pos(gui, run, &metrics, anchor, style);
 	rx = pos.x;
-	inside_selection = false;
-	p = display;
-	while ((cp = utf8_next_codepoint(p, &pnext)) != 0) {
-		if (p - display == beg) {
-			inside_selection = true;
+	inside_selection = reached_beg = reached_end = false;
+	array_foreach(run->glyphs, const gui__glyph_t, glyph) {
+		if (!reached_beg && glyph->offset >= beg) {
+			inside_selection = reached_beg = true;
 			rx = pos.x;
 		}
-		if (p - display == end) {
+		if (!reached_end && glyph->offset >= end) {
 			ry = pos.y + metrics.descent;
 			gui_rect(gui, rx, ry, pos.x - rx, rh, style->color, g_nocolor);
 			inside_selection = false;
+			reached_end = true;
 		}
-		if (cp == '\n') {
+		if (glyph->newline) {
 			if (inside_selection) {
 				ry = pos.y + metrics.descent;
 				gui_rect(gui, rx, ry, pos.x - rx, rh, style->color, g_nocolor);
 			}
 			pos.y -= metrics.newline_dist;
-			pos.x = anchor.x + gui__txt_line_offset_x(gui, pnext, style);
+			pos.x = gui__glyph_run_line_x(gui, run, ++line, anchor, style);
 			rx = pos.x;
-		} else if (gui->fonts.get_char_quad(font, cp, pos.x, pos.y, &q)) {
-			pos.x += q.advance;
+		} else {
+			pos.x += glyph->quad.advance;
 		}
-		p = pnext;
 	}
 	if (inside_selection) {
 		ry = pos.y + metrics.descent;
@@ -4395,7 +5164,7 @@ void gui__npt_txt(gui_t *gui, s32 x, s32 y, s32 w, s32 h,
 	txt2 = &display[end];
 	len2 = (u32)strlen(display) - end;
 
-	pos = gui__txt_start_pos(gui, display, anchor, style);
+	pos = gui__glyph_run_start_pos(gui, run, &metrics, anchor, style);
 	gui__txt_sequence(gui, anchor, pos.x, pos.y, txt0, len0, style, &pos.x, &pos.y);
 	gui__txt_sequence(gui, anchor, pos.x, pos.y, txt1, len1, &style_inverse, &pos.x, &pos.y);
 	gui__txt_sequence(gui, anchor, pos.x, pos.y, txt2, len2, style, &pos.x, &pos.y);
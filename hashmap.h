@@ -0,0 +1,404 @@
+#ifndef VIOLET_HASHMAP_H
+#define VIOLET_HASHMAP_H
+
+/*
+ * Open-addressing hash map in the style of array.h.
+ *
+ * A map is a pointer to its entries, each a struct with a key & value field,
+ * preceded by a hidden header.  Declare the type once & reuse it:
+ *
+ *     typedef hashmap(u32, font_t*) font_map_t;
+ *     font_map_t fonts;
+ *     hashmap_init(fonts);
+ *     *hashmap_put_null(fonts, id) = font;
+ *     font_t **font = hashmap_get(fonts, id);
+ *
+ * Keys are hashed & compared bytewise, so they must be plain data without
+ * padding (integers, pointers, packed structs); hash strings to an integer
+ * first.  Slots are probed linearly, with a control byte per slot holding
+ * 7 bits of the hash.  Lookups compare a group of 16 control bytes at once
+ * (with SSE2 where available).  Removal shifts later entries of the probe
+ * sequence back instead of leaving tombstones.
+ *
+ * Entry pointers are invalidated by any insertion or removal.
+ */
+
+#define hashmap_size_t u32
+
+#ifdef HASHMAP_STATIC
+#define HMDEF static
+#else
+#define HMDEF
+#endif
+
+#if defined HASHMAP_STATIC && !defined HASHMAP_IMPLEMENTATION
+#define HASHMAP_IMPLEMENTATION
+#endif
+
+#define HASHMAP_GROUP_SZ 16
+#define HASHMAP_NONE     (~(hashmap_size_t)0)
+
+typedef struct hashmap__head
+{
+	allocator_t *allocator;
+	u8 *ctrl;
+	hashmap_size_t sz, cap;
+	hashmap_size_t entry_sz, key_sz;
+	hashmap_size_t last;
+	hashmap_size_t padding[3];
+} hashmap__head;
+
+#define hashmap(key_type, value_type) struct { key_type key; value_type value; }*
+
+#define hashmap__get_head(m)          (((hashmap__head*)(m)) - 1)
+#define hashmap__allocator(m)         (hashmap__get_head(m)->allocator)
+#define hashmap__esz(m)               (sizeof(*(m)))
+#define hashmap__ksz(m)               (sizeof((m)->key))
+/* the slot past the end holds the key (& value) of the current operation */
+#define hashmap__scratch(m)           ((m)[hashmap_cap(m)])
+#define hashmap__last(m)              (hashmap__get_head(m)->last)
+
+#define hashmap_init(m)               hashmap_init_ex(m, 0, g_allocator)
+#define hashmap_init_ex(m, cap, alc)  ((m)=hashmap__create(cap, hashmap__esz(m), \
+                                                           hashmap__ksz(m), alc \
+                                                           MEMCALL_LOCATION))
+#define hashmap_destroy(m)            afree(hashmap__get_head(m), hashmap__allocator(m))
+
+#define hashmap_sz(m)                 (hashmap__get_head(m)->sz)
+#define hashmap_cap(m)                (hashmap__get_head(m)->cap)
+#define hashmap_empty(m)              (hashmap_sz(m) == 0)
+
+/* returns a pointer to the value, or NULL */
+#define hashmap_get(m, k)             (hashmap__scratch(m).key = (k), \
+                                       hashmap__find(m) != HASHMAP_NONE \
+                                       ? &(m)[hashmap__last(m)].value : NULL)
+#define hashmap_contains(m, k)        (hashmap__scratch(m).key = (k), \
+                                       hashmap__find(m) != HASHMAP_NONE)
+/* returns a pointer to the value, which is zeroed if the key was not present */
+#define hashmap_put_null(m, k)        (hashmap__scratch(m).key = (k), \
+                                       (m)=hashmap__insert(m  MEMCALL_LOCATION), \
+                                       &(m)[hashmap__last(m)].value)
+#define hashmap_put(m, k, v)          (*hashmap_put_null(m, k) = (v))
+#define hashmap_remove(m, k)          (hashmap__scratch(m).key = (k), \
+                                       hashmap__remove(m))
+#define hashmap_clear(m)              hashmap__clear(m)
+
+/* ensure n entries fit without rehashing */
+#define hashmap_reserve(m, n)         ((m)=hashmap__reserve(m, n  MEMCALL_LOCATION))
+/* rebuild the table with the minimum capacity fitting n entries (can shrink) */
+#define hashmap_rehash(m, n)          ((m)=hashmap__rehash(m, n  MEMCALL_LOCATION))
+
+/* visits the index of each entry, e.g. m[i].key & m[i].value */
+#define hashmap_iterate(m, it)        for (hashmap_size_t it = hashmap__next(m, 0); \
+                                           it != HASHMAP_NONE; \
+                                           it = hashmap__next(m, it + 1))
+
+
+HMDEF void *hashmap__create(hashmap_size_t cap, size_t entry_sz, size_t key_sz,
+                            allocator_t *a  MEMCALL_ARGS);
+HMDEF hashmap_size_t hashmap__find(void *m);
+HMDEF void *hashmap__insert(void *m  MEMCALL_ARGS);
+HMDEF b32   hashmap__remove(void *m);
+HMDEF void  hashmap__clear(void *m);
+HMDEF void *hashmap__reserve(void *m, hashmap_size_t n  MEMCALL_ARGS);
+HMDEF void *hashmap__rehash(void *m, hashmap_size_t n  MEMCALL_ARGS);
+HMDEF hashmap_size_t hashmap__next(void *m, hashmap_size_t idx);
+
+#endif // VIOLET_HASHMAP_H
+
+
+/* Implementation */
+
+#ifdef HASHMAP_IMPLEMENTATION
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HASHMAP__SSE2
+#endif
+
+#define HASHMAP__EMPTY 0x80
+
+typedef char *hashmap__bytep;
+
+#define hashmap__entry(m, i)       ((hashmap__bytep)(m) + (size_t)(i) * hashmap__get_head(m)->entry_sz)
+#define hashmap__entries_sz(cap, esz) ((size_t)((cap) + 1) * (esz))
+#define hashmap__ctrl_sz(cap)      ((cap) ? (size_t)(cap) + HASHMAP_GROUP_SZ : 0)
+
+static
+u64 hashmap__hash(const void *key, size_t key_sz)
+{
+	u64 h;
+	if (key_sz == sizeof(u32)) {
+		u32 k;
+		memcpy(&k, key, sizeof(k));
+		h = k;
+	} else if (key_sz == sizeof(u64)) {
+		memcpy(&h, key, sizeof(h));
+	} else {
+		/* FNV-1a */
+		const u8 *p = key;
+		h = 0xcbf29ce484222325ull;
+		for (size_t i = 0; i < key_sz; ++i)
+			h = (h ^ p[i]) * 0x100000001b3ull;
+	}
+	/* finalizer from MurmurHash3, so similar keys spread across the table */
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdull;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ull;
+	h ^= h >> 33;
+	return h;
+}
+
+/* entries may be packed, so keys are not necessarily aligned */
+static
+b32 hashmap__key_eq(const void *lhs, const void *rhs, size_t key_sz)
+{
+	if (key_sz == sizeof(u32)) {
+		u32 l, r;
+		memcpy(&l, lhs, sizeof(l));
+		memcpy(&r, rhs, sizeof(r));
+		return l == r;
+	} else if (key_sz == sizeof(u64)) {
+		u64 l, r;
+		memcpy(&l, lhs, sizeof(l));
+		memcpy(&r, rhs, sizeof(r));
+		return l == r;
+	} else {
+		return memcmp(lhs, rhs, key_sz) == 0;
+	}
+}
+
+/* Bit i of the result is set when ctrl[i] == byte */
+static
+u32 hashmap__group_match(const u8 *ctrl, u8 byte)
+{
+#ifdef HASHMAP__SSE2
+	const __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+	return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)byte)));
+#else
+	u32 mask = 0;
+	for (u32 i = 0; i < HASHMAP_GROUP_SZ; ++i)
+		if (ctrl[i] == byte)
+			mask |= 1u << i;
+	return mask;
+#endif
+}
+
+static
+u32 hashmap__ctz(u32 x)
+{
+#if defined(_MSC_VER)
+	unsigned long idx;
+	_BitScanForward(&idx, x);
+	return idx;
+#else
+	return (u32)__builtin_ctz(x);
+#endif
+}
+
+static
+void hashmap__set_ctrl(hashmap__head *head, hashmap_size_t i, u8 ctrl)
+{
+	head->ctrl[i] = ctrl;
+	/* mirror the start of the table, so groups can be loaded past the end */
+	if (i < HASHMAP_GROUP_SZ)
+		head->ctrl[head->cap + i] = ctrl;
+}
+
+static
+hashmap_size_t hashmap__min_cap(hashmap_size_t n)
+{
+	hashmap_size_t cap;
+	if (n == 0)
+		return 0;
+	cap = HASHMAP_GROUP_SZ;
+	/* max load factor of 7/8 */
+	while ((u64)cap * 7 / 8 < n)
+		cap <<= 1;
+	return cap;
+}
+
+HMDEF void *hashmap__create(hashmap_size_t cap_, size_t entry_sz, size_t key_sz,
+                            allocator_t *a  MEMCALL_ARGS)
+{
+	const hashmap_size_t cap = hashmap__min_cap(cap_);
+	const size_t entries_sz = hashmap__entries_sz(cap, entry_sz);
+	hashmap__head *head = a->malloc_(sizeof(hashmap__head) + entries_sz
+	                                 + hashmap__ctrl_sz(cap), a  MEMCALL_VARS);
+	if (!head) { fatal("hashmap__create: oom"); }
+	head->allocator = a;
+	head->sz = 0;
+	head->cap = cap;
+	head->entry_sz = (hashmap_size_t)entry_sz;
+	head->key_sz = (hashmap_size_t)key_sz;
+	head->last = HASHMAP_NONE;
+	head->ctrl = cap ? (u8*)(head + 1) + entries_sz : NULL;
+	if (cap)
+		memset(head->ctrl, HASHMAP__EMPTY, hashmap__ctrl_sz(cap));
+	return head + 1;
+}
+
+/* Finds the slot of the key in scratch, or the empty slot it belongs in */
+static
+hashmap_size_t hashmap__probe(void *m, b32 *found)
+{
+	hashmap__head *head = hashmap__get_head(m);
+	const hashmap_size_t mask = head->cap - 1;
+	const void *key = hashmap__entry(m, head->cap);
+	const u64 hash = hashmap__hash(key, head->key_sz);
+	const u8 tag = (u8)(hash >> 57);
+	hashmap_size_t pos = (hashmap_size_t)hash & mask;
+
+	for (;;) {
+		const u8 *group = &head->ctrl[pos];
+		u32 match = hashmap__group_match(group, tag);
+		u32 empty;
+		while (match) {
+			const hashmap_size_t idx = (pos + hashmap__ctz(match)) & mask;
+			if (hashmap__key_eq(hashmap__entry(m, idx), key, head->key_sz)) {
+				*found = true;
+				return idx;
+			}
+			match &= match - 1;
+		}
+		if ((empty = hashmap__group_match(group, HASHMAP__EMPTY))) {
+			*found = false;
+			return (pos + hashmap__ctz(empty)) & mask;
+		}
+		pos = (pos + HASHMAP_GROUP_SZ) & mask;
+	}
+}
+
+HMDEF hashmap_size_t hashmap__find(void *m)
+{
+	hashmap__head *head = hashmap__get_head(m);
+	b32 found;
+	hashmap_size_t idx;
+
+	if (head->sz == 0)
+		return HASHMAP_NONE;
+
+	idx = hashmap__probe(m, &found);
+	head->last = found ? idx : HASHMAP_NONE;
+	return head->last;
+}
+
+HMDEF void *hashmap__rehash(void *m, hashmap_size_t n  MEMCALL_ARGS)
+{
+	hashmap__head *head = hashmap__get_head(m);
+	const size_t entry_sz = head->entry_sz;
+	void *dst;
+	b32 found;
+
+	if (n < head->sz)
+		n = head->sz;
+
+	dst = hashmap__create(n, entry_sz, head->key_sz, head->allocator  MEMCALL_VARS);
+	for (hashmap_size_t i = 0; i < head->cap; ++i) {
+		if (head->ctrl[i] != HASHMAP__EMPTY) {
+			hashmap__head *dst_head = hashmap__get_head(dst);
+			hashmap_size_t idx;
+			memcpy(hashmap__entry(dst, dst_head->cap), hashmap__entry(m, i), entry_sz);
+			idx = hashmap__probe(dst, &found);
+			memcpy(hashmap__entry(dst, idx), hashmap__entry(m, i), entry_sz);
+			hashmap__set_ctrl(dst_head, idx, head->ctrl[i]);
+			++dst_head->sz;
+		}
+	}
+	memcpy(hashmap__entry(dst, hashmap_cap(dst)), hashmap__entry(m, head->cap), entry_sz);
+	afree(head, head->allocator);
+	return dst;
+}
+
+HMDEF void *hashmap__reserve(void *m, hashmap_size_t n  MEMCALL_ARGS)
+{
+	return hashmap__min_cap(n) > hashmap_cap(m)
+	     ? hashmap__rehash(m, n  MEMCALL_VARS)
+	     : m;
+}
+
+HMDEF void *hashmap__insert(void *m  MEMCALL_ARGS)
+{
+	hashmap__head *head = hashmap__get_head(m);
+	hashmap_size_t idx;
+	b32 found;
+	u64 hash;
+
+	if (head->sz > 0) {
+		idx = hashmap__probe(m, &found);
+		if (found) {
+			head->last = idx;
+			return m;
+		}
+	}
+
+	if (hashmap__min_cap(head->sz + 1) > head->cap) {
+		/* the most entries the doubled table holds, so it isn't sized up again */
+		const hashmap_size_t n = (hashmap_size_t)((u64)head->cap * 2 * 7 / 8);
+		m = hashmap__rehash(m, max(head->sz + 1, n)  MEMCALL_VARS);
+		head = hashmap__get_head(m);
+	}
+
+	idx = hashmap__probe(m, &found);
+	hash = hashmap__hash(hashmap__entry(m, head->cap), head->key_sz);
+	memcpy(hashmap__entry(m, idx), hashmap__entry(m, head->cap), head->key_sz);
+	memset(hashmap__entry(m, idx) + head->key_sz, 0, head->entry_sz - head->key_sz);
+	hashmap__set_ctrl(head, idx, (u8)(hash >> 57));
+	++head->sz;
+	head->last = idx;
+	return m;
+}
+
+HMDEF b32 hashmap__remove(void *m)
+{
+	hashmap__head *head = hashmap__get_head(m);
+	const hashmap_size_t mask = head->cap - 1;
+	hashmap_size_t i, j;
+	b32 found;
+
+	if (head->sz == 0)
+		return false;
+
+	i = hashmap__probe(m, &found);
+	if (!found)
+		return false;
+
+	/* shift back entries whose probe sequence passes through the hole */
+	for (j = (i + 1) & mask; head->ctrl[j] != HASHMAP__EMPTY; j = (j + 1) & mask) {
+		const u64 hash = hashmap__hash(hashmap__entry(m, j), head->key_sz);
+		const hashmap_size_t home = (hashmap_size_t)hash & mask;
+		const b32 home_in_gap = i <= j ? (home > i && home <= j)
+		                               : (home > i || home <= j);
+		if (!home_in_gap) {
+			memcpy(hashmap__entry(m, i), hashmap__entry(m, j), head->entry_sz);
+			hashmap__set_ctrl(head, i, head->ctrl[j]);
+			i = j;
+		}
+	}
+	hashmap__set_ctrl(head, i, HASHMAP__EMPTY);
+	--head->sz;
+	head->last = HASHMAP_NONE;
+	return true;
+}
+
+HMDEF void hashmap__clear(void *m)
+{
+	hashmap__head *head = hashmap__get_head(m);
+	if (head->cap)
+		memset(head->ctrl, HASHMAP__EMPTY, hashmap__ctrl_sz(head->cap));
+	head->sz = 0;
+	head->last = HASHMAP_NONE;
+}
+
+HMDEF hashmap_size_t hashmap__next(void *m, hashmap_size_t idx)
+{
+	const hashmap__head *head = hashmap__get_head(m);
+	for (hashmap_size_t i = idx; i < head->cap; ++i)
+		if (head->ctrl[i] != HASHMAP__EMPTY)
+			return i;
+	return HASHMAP_NONE;
+}
+
+#undef HASHMAP_IMPLEMENTATION
+#endif // HASHMAP_IMPLEMENTATION
@@ -4,6 +4,8 @@
 #include <errno.h>
 #include <stdio.h>
 #include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/utsname.h>
 #include <unistd.h>
@@ -299,6 +301,30 @@ out:
 	return bytes;
 }
 
+const void *file_map(const char *fname, size_t *sz)
+{
+	struct stat st;
+	void *data;
+	int fd = open(fname, O_RDONLY);
+	if (fd == -1)
+		return NULL;
+	if (fstat(fd, &st) == -1 || st.st_size == 0) {
+		close(fd);
+		return NULL;
+	}
+	data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return NULL;
+	*sz = (size_t)st.st_size;
+	return data;
+}
+
+void file_unmap(const void *data, size_t sz)
+{
+	munmap((void*)data, sz);
+}
+
 /* Dynamic library */
 
 #ifndef VIOLET_NO_LIB
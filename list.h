@@ -25,6 +25,7 @@ typedef struct list__item_header
 
 #define list(type) list_t
 
+/* each item is a separate allocation - a pool allocator keeps them together */
 #define list_create()             list_create_ex(g_allocator)
 #define list_create_ex(a)         (list_t){ .allocator = a }
 #define list__allocator(l)        (l).allocator
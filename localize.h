@@ -11,10 +11,28 @@
 #define LOCALIZE_MAX_STR_BYTES 256
 #endif
 
+/* With GNU extensions, each LOCALIZE call site on a string literal caches its
+ * hash & result, which are only recomputed when the language changes. */
+#if defined(__GNUC__) || defined(__clang__)
+#define LOCALIZE(str) \
+	(__builtin_constant_p(str) \
+	 ? ({ static localize_site_t localize__site = {0}; localize_site(&localize__site, str); }) \
+	 : localize_string(str))
+#else
 #define LOCALIZE(str) localize_string(str)
+#endif
 #define LOCALIZE_STATIC(str) str
 
+typedef struct localize_site {
+	const char *str;
+	const char *localized;
+	u32 id;
+	u32 generation;
+} localize_site_t;
+
 const char *localize_string(const char *str);
+const char *localize_site(localize_site_t *site, const char *str);
+void        localize_invalidate(void);
 
 b32  localize_is_language_default(void);
 void localize_set_language_default(const char *fname);
@@ -39,6 +57,37 @@ b32  localization_table_find_slot(localization_table_t *table, u32 id,
 u32  localization_table_num_strings(const localization_table_t *table);
 u32  localization_table_num_bytes(const localization_table_t *table);
 
+/* Compiled tables (built by localize_compile) have no size limits & are mapped
+ * read-only without parsing.  Each string is found through a minimal perfect
+ * hash: the id picks a bucket, whose seed places it in a unique slot. */
+#define LOCALIZE_COMPILED_MAGIC   0x434f4c56 /* VLOC */
+#define LOCALIZE_COMPILED_VERSION 1
+
+typedef struct localization_compiled_header {
+	u32 magic;
+	u32 version;
+	u32 num_strings;
+	u32 num_buckets;
+	u32 num_bytes;
+	/* followed by u32 seeds[num_buckets], localized_string_t strings[num_strings]
+	 * & char chars[num_bytes] */
+} localization_compiled_header_t;
+
+typedef struct localization_compiled {
+	const void *data;
+	size_t size;
+	const localization_compiled_header_t *header;
+	const u32 *seeds;
+	const localized_string_t *strings;
+	const char *chars;
+} localization_compiled_t;
+
+b32  localization_compiled_map(localization_compiled_t *table, const char *fname);
+void localization_compiled_unmap(localization_compiled_t *table);
+const char *localization_compiled_find(const localization_compiled_t *table, u32 id);
+u32  localization_compiled_bucket(u32 id, u32 num_buckets);
+u32  localization_compiled_slot(u32 id, u32 seed, u32 num_strings);
+
 #else // NO_LOCALIZE
 
 #define LOCALIZE(str) str
@@ -59,14 +108,21 @@ u32 g_lang = 0;
 u32 g_lang_default = 0;
 
 localization_table_t g_localization_table = {0};
+localization_compiled_t g_localization_compiled = {0};
 
-const char *localize_string(const char *str)
+/* 0 is never a valid generation, so zeroed call sites start out stale */
+static u32 g_localize_generation = 1;
+
+static
+const char *localize__find(u32 id, const char *str)
 {
-	if (g_lang == g_lang_default)
-		return str;
+	if (g_localization_compiled.data) {
+		const char *localized = localization_compiled_find(&g_localization_compiled, id);
+		return localized ? localized : str;
+	}
 
 	localized_string_t *slot;
-	if (   localization_table_find_slot(&g_localization_table, hash_compute(str), &slot)
+	if (   localization_table_find_slot(&g_localization_table, id, &slot)
 	    && slot->id != 0) {
 		return &g_localization_table.chars[slot->index];
 	} else {
@@ -81,6 +137,36 @@ const char *localize_string(const char *str)
 	}
 }
 
+const char *localize_string(const char *str)
+{
+	if (g_lang == g_lang_default)
+		return str;
+	return localize__find(hash_compute(str), str);
+}
+
+const char *localize_site(localize_site_t *site, const char *str)
+{
+	if (g_lang == g_lang_default)
+		return str;
+
+	if (site->str != str) {
+		site->str = str;
+		site->id = hash_compute(str);
+		site->generation = 0;
+	}
+	if (site->generation != g_localize_generation) {
+		site->localized = localize__find(site->id, str);
+		site->generation = g_localize_generation;
+	}
+	return site->localized;
+}
+
+void localize_invalidate(void)
+{
+	if (++g_localize_generation == 0)
+		g_localize_generation = 1;
+}
+
 b32 localize_is_language_default(void)
 {
 	return g_lang == g_lang_default;
@@ -105,6 +191,16 @@ b32 localize_set_language(const char *fname)
 
 	u32 new_lang = g_lang_default;
 
+	localization_compiled_unmap(&g_localization_compiled);
+	if (localization_compiled_map(&g_localization_compiled, fname)) {
+		log_info("switched to compiled language %s", fname);
+		log_debug("localization table has %u strings in %u bytes",
+		          g_localization_compiled.header->num_strings,
+		          g_localization_compiled.header->num_bytes);
+		new_lang = lang;
+		goto out;
+	}
+
 	if (!localization_table_load(&g_localization_table, fname)) {
 		memclr(g_localization_table);
 		goto out;
@@ -122,11 +218,16 @@ b32 localize_set_language(const char *fname)
 
 out:
 	g_lang = new_lang;
+	localize_invalidate();
 	return g_lang == lang;
 }
 
 b32 localize_save_language(const char *fname)
 {
+	if (g_localization_compiled.data) {
+		log_error("cannot save compiled language table to '%s'", fname);
+		return false;
+	}
 	return localization_table_save(&g_localization_table, fname);
 }
 
@@ -257,6 +358,93 @@ u32 localization_table_num_bytes(const localization_table_t *table)
 	return num_bytes;
 }
 
+b32 localization_compiled_map(localization_compiled_t *table, const char *fname)
+{
+	const localization_compiled_header_t *header;
+	size_t size = 0, expected_size;
+	const u8 *data = file_map(fname, &size);
+
+	memclr(*table);
+	if (!data)
+		return false;
+
+	header = (const localization_compiled_header_t*)data;
+	if (   size < sizeof(*header)
+	    || header->magic != LOCALIZE_COMPILED_MAGIC) {
+		/* not compiled, the caller can try the text format */
+		file_unmap(data, size);
+		return false;
+	}
+
+	expected_size = sizeof(*header)
+	              + (size_t)header->num_buckets * sizeof(u32)
+	              + (size_t)header->num_strings * sizeof(localized_string_t)
+	              + header->num_bytes;
+	if (header->version != LOCALIZE_COMPILED_VERSION) {
+		log_error("language file '%s' has version %u, expected %u",
+		          fname, header->version, LOCALIZE_COMPILED_VERSION);
+		goto err;
+	}
+	if (   size != expected_size
+	    || (header->num_strings > 0 && header->num_buckets == 0)
+	    || header->num_bytes == 0
+	    || data[size - 1] != 0) {
+		log_error("language file '%s' is corrupt", fname);
+		goto err;
+	}
+
+	table->data    = data;
+	table->size    = size;
+	table->header  = header;
+	table->seeds   = (const u32*)(header + 1);
+	table->strings = (const localized_string_t*)(table->seeds + header->num_buckets);
+	table->chars   = (const char*)(table->strings + header->num_strings);
+	return true;
+
+err:
+	file_unmap(data, size);
+	return false;
+}
+
+void localization_compiled_unmap(localization_compiled_t *table)
+{
+	if (table->data)
+		file_unmap(table->data, table->size);
+	memclr(*table);
+}
+
+const char *localization_compiled_find(const localization_compiled_t *table, u32 id)
+{
+	const localization_compiled_header_t *header = table->header;
+	const localized_string_t *string;
+	u32 seed;
+
+	if (header->num_strings == 0)
+		return NULL;
+
+	seed = table->seeds[localization_compiled_bucket(id, header->num_buckets)];
+	string = &table->strings[localization_compiled_slot(id, seed, header->num_strings)];
+	return string->id == id && string->index < header->num_bytes
+	     ? &table->chars[string->index] : NULL;
+}
+
+u32 localization_compiled_bucket(u32 id, u32 num_buckets)
+{
+	return id % num_buckets;
+}
+
+u32 localization_compiled_slot(u32 id, u32 seed, u32 num_strings)
+{
+	/* finalizer from MurmurHash3 */
+	u32 h = id ^ (seed * 0x9e3779b9u);
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h % num_strings;
+}
+
 #else // NO_LOCALIZE
 
 u32 g_lang = 0;
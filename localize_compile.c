@@ -0,0 +1,229 @@
+#define CORE_IMPLEMENTATION
+#define ARRAY_IMPLEMENTATION
+#define HASHMAP_IMPLEMENTATION
+#define STRING_IMPLEMENTATION
+#define OS_IMPLEMENTATION
+#define VSON_IMPLEMENTATION
+#define LOCALIZE_IMPLEMENTATION
+#include "violet/core.h"
+#include "violet/array.h"
+#include "violet/hashmap.h"
+#include "violet/string.h"
+#include "violet/os.h"
+#include "violet/vson.h"
+#include "violet/localize.h"
+
+#define MAX_SEED_ATTEMPTS (1u << 24)
+
+typedef struct bucket
+{
+	array(u32) strings;
+} bucket_t;
+
+static void usage(void)
+{
+	printf("Usage: localize_compile <LANGUAGE_FILE> <COMPILED_FILE>\n");
+}
+
+static
+int bucket__sort_desc(const void *lhs_, const void *rhs_)
+{
+	const bucket_t *const *lhs = lhs_, *const *rhs = rhs_;
+	const u32 lhs_sz = array_sz((*lhs)->strings), rhs_sz = array_sz((*rhs)->strings);
+	return lhs_sz > rhs_sz ? -1 : lhs_sz < rhs_sz ? 1 : 0;
+}
+
+static
+b32 read_strings(const char *fname, array(localized_string_t) *strings, array(char) *chars)
+{
+	b32 success = false;
+	char str[4096];
+	u32 num_strings;
+	hashmap(u32, b32) ids;
+	FILE *fp = file_open(fname, "rb");
+	if (!fp) {
+		printf("Failed to open language file '%s'\n", fname);
+		return false;
+	}
+
+	hashmap_init(ids);
+
+	if (!vson_read_u32(fp, "num_strings", &num_strings)) {
+		printf("Failed to read language.num_strings\n");
+		goto out;
+	}
+
+	/* skip byte 0 so a bad index points to an empty string */
+	array_append(*chars, 0);
+
+	for (u32 i = 0; i < num_strings; ++i) {
+		localized_string_t string;
+
+		if (!vson_read_u32(fp, "id", &string.id)) {
+			printf("Failed to read language.id #%u\n", i);
+			goto out;
+		}
+		if (!vson_read_str(fp, "str", B2PC(str))) {
+			printf("Failed to read language.str #%u\n", i);
+			goto out;
+		}
+
+		if (hashmap_contains(ids, string.id)) {
+			printf("Skipping duplicate language string entry '%u'\n", string.id);
+			continue;
+		}
+		hashmap_put(ids, string.id, true);
+
+		string.index = array_sz(*chars);
+		array_appendn(*chars, str, (array_size_t)strlen(str) + 1);
+		array_append(*strings, string);
+	}
+	success = true;
+
+out:
+	hashmap_destroy(ids);
+	fclose(fp);
+	return success;
+}
+
+/* Hash & displace: buckets are placed largest first, each searching for a seed
+ * that sends all of its strings to unused slots. */
+static
+b32 build_perfect_hash(const array(localized_string_t) strings, array(u32) seeds,
+                       array(localized_string_t) slots)
+{
+	const u32 num_strings = array_sz(strings);
+	const u32 num_buckets = array_sz(seeds);
+	array(bucket_t) buckets;
+	array(bucket_t*) order;
+	array(b32) taken;
+	array(u32) candidate;
+	b32 success = true;
+
+	array_init(buckets, num_buckets);
+	array_init(order, num_buckets);
+	array_init(taken, num_strings);
+	array_init(candidate, 8);
+	array_set_sz(taken, num_strings);
+	memset(taken, 0, num_strings * sizeof(taken[0]));
+
+	for (u32 i = 0; i < num_buckets; ++i)
+		array_append(buckets, (bucket_t){ .strings = array_create() });
+	for (u32 i = 0; i < num_strings; ++i)
+		array_append(buckets[localization_compiled_bucket(strings[i].id, num_buckets)].strings, i);
+	array_foreach(buckets, bucket_t, bucket)
+		array_append(order, bucket);
+	array_qsort(order, bucket__sort_desc);
+
+	array_foreach(order, bucket_t*, bucket_ptr) {
+		const bucket_t *bucket = *bucket_ptr;
+		const u32 bucket_idx = (u32)(bucket - buckets);
+		u32 seed;
+
+		seeds[bucket_idx] = 0;
+		if (array_empty(bucket->strings))
+			continue;
+
+		for (seed = 1; seed < MAX_SEED_ATTEMPTS; ++seed) {
+			b32 placed = true;
+			array_clear(candidate);
+			array_foreach(bucket->strings, u32, string_idx) {
+				const u32 slot = localization_compiled_slot(strings[*string_idx].id, seed, num_strings);
+				b32 collides = taken[slot];
+				array_foreach(candidate, u32, other)
+					collides |= *other == slot;
+				if (collides) {
+					placed = false;
+					break;
+				}
+				array_append(candidate, slot);
+			}
+			if (placed)
+				break;
+		}
+
+		if (seed == MAX_SEED_ATTEMPTS) {
+			printf("Failed to find a seed for bucket %u\n", bucket_idx);
+			success = false;
+			goto out;
+		}
+
+		seeds[bucket_idx] = seed;
+		array_iterate(bucket->strings, i, n) {
+			taken[candidate[i]] = true;
+			slots[candidate[i]] = strings[bucket->strings[i]];
+		}
+	}
+
+out:
+	array_foreach(buckets, bucket_t, bucket)
+		array_destroy(bucket->strings);
+	array_destroy(buckets);
+	array_destroy(order);
+	array_destroy(taken);
+	array_destroy(candidate);
+	return success;
+}
+
+int main(int argc, char *const argv[])
+{
+	int ret = 1;
+	array(localized_string_t) strings;
+	array(localized_string_t) slots;
+	array(u32) seeds;
+	array(char) chars;
+	localization_compiled_header_t header;
+	FILE *fp;
+
+	if (argc != 3) {
+		usage();
+		return 1;
+	}
+
+	log_add_stream(LOG_ALL, file_logger, stdout);
+
+	strings = array_create();
+	slots = array_create();
+	seeds = array_create();
+	chars = array_create();
+
+	if (!read_strings(argv[1], &strings, &chars))
+		goto out;
+
+	header.magic       = LOCALIZE_COMPILED_MAGIC;
+	header.version     = LOCALIZE_COMPILED_VERSION;
+	header.num_strings = array_sz(strings);
+	header.num_buckets = max(1u, (header.num_strings + 1) / 2);
+	header.num_bytes   = array_sz(chars);
+
+	array_set_sz(seeds, header.num_buckets);
+	array_set_sz(slots, header.num_strings);
+	if (!build_perfect_hash(strings, seeds, slots))
+		goto out;
+
+	fp = file_open(argv[2], "wb");
+	if (!fp) {
+		printf("Failed to open file '%s'\n", argv[2]);
+		goto out;
+	}
+	if (   fwrite(&header, sizeof(header), 1, fp) != 1
+	    || fwrite(seeds, sizeof(seeds[0]), header.num_buckets, fp) != header.num_buckets
+	    || fwrite(slots, sizeof(slots[0]), header.num_strings, fp) != header.num_strings
+	    || fwrite(chars, 1, header.num_bytes, fp) != header.num_bytes) {
+		printf("Failed to write file '%s'\n", argv[2]);
+		fclose(fp);
+		goto out;
+	}
+	fclose(fp);
+
+	printf("Compiled %u strings (%u bytes) into '%s'\n",
+	       header.num_strings, header.num_bytes, argv[2]);
+	ret = 0;
+
+out:
+	array_destroy(strings);
+	array_destroy(slots);
+	array_destroy(seeds);
+	array_destroy(chars);
+	return ret;
+}
@@ -82,6 +82,9 @@ char *imuserdatapath(const char *resource);
 
 FILE  *file_open(const char *fname, const char *mode);
 void  *file_read_all(const char *fname, const char *mode, size_t *sz, allocator_t *a);
+/* maps a whole file read-only (or reads it, where mapping is unavailable) */
+const void *file_map(const char *fname, size_t *sz);
+void        file_unmap(const void *data, size_t sz);
 
 /* Dynamic library */
 
@@ -9,6 +9,14 @@
  * shared between multiple allocators. In addition to traditional memory
  * calls, a watermark can be saved & restored as an easy way to free many
  * allocations at once.
+ *
+ * Heaps are single-threaded, but can be backed by a thread-safe pool.
+ * A pooled heap only keeps a few unused pages around as a cache, handing
+ * the rest back to the pool, where heaps on other threads can reuse them.
+ *
+ * With PGB_MMAP on linux, pages are carved out of one large reserved range
+ * of address space instead of PGB_MALLOC, & pages idle in a pool for
+ * PGB_IDLE_GENERATIONS calls to pgb_pool_advance_gen give their memory back.
  */
 
 #ifndef PGB_MIN_PAGE_SIZE
@@ -45,14 +53,107 @@
 #define PGB_LOG_REALLOC(...)
 #endif
 
+/* Called whenever an allocator takes another page from its heap */
+#ifndef PGB_ON_ADD_PAGE
+#define PGB_ON_ADD_PAGE(page_size)
+#endif
+
+/* Number of unused pages a pooled heap keeps before returning them to the pool */
+#ifndef PGB_HEAP_CACHE_PAGES
+#define PGB_HEAP_CACHE_PAGES 4
+#endif
+
+/* Pages are pooled by power-of-two size classes starting at PGB_MIN_PAGE_SIZE;
+ * the last class holds everything larger */
+#ifndef PGB_POOL_CLASSES
+#define PGB_POOL_CLASSES 16
+#endif
+
+#if defined(PGB_MMAP) && defined(__linux__)
+#define PGB__MMAP
+#endif
+
+/* Address space reserved up front for pages, committed on demand */
+#ifndef PGB_MMAP_RESERVE
+#if INTPTR_MAX == INT64_MAX
+#define PGB_MMAP_RESERVE ((size_t)64 << 30)
+#else
+#define PGB_MMAP_RESERVE ((size_t)512 << 20)
+#endif
+#endif
+
+/* Freed pages hand their part of the reserved range back in a table of this
+ * many free ranges; once it is full, further freed ranges aren't reused */
+#ifndef PGB_MMAP_FREE_RANGES
+#define PGB_MMAP_FREE_RANGES 256
+#endif
+
+/* Pages at least this large are aligned to & advised as transparent huge pages */
+#ifndef PGB_HUGE_PAGE_SIZE
+#define PGB_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#endif
+
+#ifndef PGB_IDLE_GENERATIONS
+#define PGB_IDLE_GENERATIONS 300
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+typedef volatile long pgb_lock_t;
+#define pgb__lock_try(l)     (_InterlockedExchange(l, 1) == 0)
+#define pgb__lock_release(l) _InterlockedExchange(l, 0)
+/* aligned word reads are atomic on the platforms msvc targets */
+#define pgb__load_relaxed(p) (p)
+#define pgb__store_relaxed(p, v) ((p) = (v))
+#else
+typedef volatile int pgb_lock_t;
+#define pgb__lock_try(l)     (__atomic_exchange_n(l, 1, __ATOMIC_ACQUIRE) == 0)
+#define pgb__lock_release(l) __atomic_store_n(l, 0, __ATOMIC_RELEASE)
+#define pgb__load_relaxed(p) __atomic_load_n(&(p), __ATOMIC_RELAXED)
+#define pgb__store_relaxed(p, v) __atomic_store_n(&(p), v, __ATOMIC_RELAXED)
+#endif
+
+#define PGB__CACHE_LINE 64
+#ifdef _MSC_VER
+#define PGB__CACHE_ALIGNED __declspec(align(PGB__CACHE_LINE))
+#else
+#define PGB__CACHE_ALIGNED __attribute__((aligned(PGB__CACHE_LINE)))
+#endif
+
+/* each class fills exactly one cache line, so threads taking pages of
+ * different sizes don't contend over a shared line */
+typedef union PGB__CACHE_ALIGNED pgb_pool_class
+{
+	struct
+	{
+		pgb_lock_t lock;
+		struct pgb_page *first_page;
+	};
+	uint8_t line[PGB__CACHE_LINE];
+} pgb_pool_class_t;
+
+typedef struct pgb_pool
+{
+	pgb_pool_class_t classes[PGB_POOL_CLASSES];
+	size_t generation;
+} pgb_pool_t;
+
+void pgb_pool_init(pgb_pool_t *pool);
+void pgb_pool_destroy(pgb_pool_t *pool);
+/* Releases the memory of pages that have been idle in the pool for a while */
+void pgb_pool_advance_gen(pgb_pool_t *pool);
+
 typedef struct pgb_heap
 {
 	struct pgb_page *gfirst_page;
 	struct pgb_page *glast_page;
 	struct pgb_page *first_page;
+	struct pgb_pool *pool;
+	size_t num_pages;
 } pgb_heap_t;
 
 void pgb_heap_init(pgb_heap_t *heap);
+void pgb_heap_init_pooled(pgb_heap_t *heap, pgb_pool_t *pool);
 void pgb_heap_destroy(pgb_heap_t *heap);
 
 struct pgb_page *pgb_heap_borrow_page(pgb_heap_t *heap, size_t min_size, size_t max_size);
@@ -64,11 +165,31 @@ void pgb_heap_move_all_pages(pgb_heap_t *dst, pgb_heap_t *src);
 
 typedef uint8_t pgb_byte;
 
-typedef struct pgb_watermark_data
+/* Allocations up to PGB_SMALL_ALLOC_SIZE bytes are bumped into their own
+ * stack of pages, with slots of at most PGB_SMALL_PAGE_MAX_SIZE / 256 bytes,
+ * so they don't occupy the large slots of pages sized for big allocations */
+#ifndef PGB_SMALL_ALLOC_SIZE
+#define PGB_SMALL_ALLOC_SIZE 256
+#endif
+
+#ifndef PGB_SMALL_PAGE_MAX_SIZE
+#define PGB_SMALL_PAGE_MAX_SIZE (2 * PGB_MIN_PAGE_SIZE)
+#endif
+
+#define PGB__LANE_SMALL 0
+#define PGB__LANE_LARGE 1
+#define PGB__LANES      2
+
+typedef struct pgb_lane
 {
-	struct pgb *pgb;
 	struct pgb_page *page;
 	pgb_byte *ptr;
+} pgb_lane_t;
+
+typedef struct pgb_watermark_data
+{
+	struct pgb *pgb;
+	pgb_lane_t lanes[PGB__LANES];
 } pgb_watermark_data_t;
 
 typedef struct pgb_watermark
@@ -80,8 +201,7 @@ typedef struct pgb_watermark
 typedef struct pgb
 {
 	struct pgb_heap *heap;
-	struct pgb_page *current_page;
-	pgb_byte *current_ptr;
+	pgb_lane_t lanes[PGB__LANES];
 	pgb_watermark_t last_mark;
 } pgb_t;
 
@@ -117,7 +237,10 @@ void pgb_watermark_stats(pgb_watermark_t mark, size_t *bytes_used, size_t *pages
  * This causes the header size to be constant, which is more efficent for larger pages.
  *
  * Perhaps the biggest drawback is the loss of efficiency when allocating
- * small objects into large pages.
+ * small objects into large pages.  To limit this, each allocator keeps two
+ * stacks of pages (lanes): small allocations go to pages of at most
+ * PGB_SMALL_PAGE_MAX_SIZE, everything else to pages sized for it.  A
+ * watermark records the top of both lanes.
  *
  * Not all slots will be available, since some are required to store the page header.
  * Num slots = max(1, sizeof(header) / alignment)
@@ -127,7 +250,9 @@ void pgb_watermark_stats(pgb_watermark_t mark, size_t *bytes_used, size_t *pages
  *   128K  ->  512 byte alignment -> 255 usable slots -> 99% efficient
  *
  * Unused pages are stored in a heap that can be shared across multiple allocators.
- * This heap is not thread-safe.
+ * This heap is not thread-safe.  Heaps on different threads can instead share
+ * pages through a pool, which guards the free list of each size class with a
+ * spinlock.  The pool is only touched when a heap's cache misses or overflows.
  */
 
 
@@ -140,10 +265,13 @@ typedef struct pgb_page
 {
 	struct {
 		pgb_byte alloc_sizes[PGB__PAGE_SLOTS];
+		struct pgb_page *gprev;
 		struct pgb_page *gnext;
 		struct pgb_page *prev;
 		struct pgb_page *next;
 		size_t size;
+		size_t idle_gen;
+		bool trimmed;
 		pgb_byte header_end;
 	};
 } pgb_page_t;
@@ -169,6 +297,8 @@ typedef union pgb__max_align
 
 pgb_static_assert(sizeof(pgb__max_align_t) <= pgb__alignment(PGB_MIN_PAGE_SIZE),
                   invalid_word_size_for_pgb_allocator);
+pgb_static_assert(sizeof(pgb_pool_class_t) == PGB__CACHE_LINE,
+                  pgb_pool_class_must_fill_one_cache_line);
 
 #define pgb__page_alignment(page)   (pgb__alignment((page)->size))
 #define pgb__page_beg(page)         ((pgb_byte*)page)
@@ -282,11 +412,210 @@ void pgb__page_clear(pgb_page_t *page)
 	page->next = NULL;
 }
 
+/* Page source */
+
+#ifdef PGB__MMAP
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+typedef struct pgb__mmap_range
+{
+	pgb_byte *beg;
+	size_t size;
+} pgb__mmap_range_t;
+
+static struct
+{
+	pgb_lock_t lock;
+	pgb_byte *beg, *end, *next;
+	bool reserved;
+	pgb__mmap_range_t free_ranges[PGB_MMAP_FREE_RANGES];
+	size_t num_free_ranges;
+} pgb__mmap_source;
+
+static
+void pgb__lock(pgb_lock_t *lock);
+
+static
+size_t pgb__os_page_size(void)
+{
+	return (size_t)sysconf(_SC_PAGESIZE);
+}
+
+static
+bool pgb__ptr_in_mmap_source(const void *ptr)
+{
+	return (const pgb_byte*)ptr >= pgb__mmap_source.beg
+	    && (const pgb_byte*)ptr <  pgb__mmap_source.end;
+}
+
+/* Takes the smallest freed range that fits, leaving the rest of it free */
+static
+pgb_byte *pgb__mmap_take_free_range(size_t size, size_t alignment)
+{
+	pgb__mmap_range_t *best = NULL;
+	pgb_byte *page, *range_end;
+
+	for (size_t i = 0; i < pgb__mmap_source.num_free_ranges; ++i) {
+		pgb__mmap_range_t *range = &pgb__mmap_source.free_ranges[i];
+		const size_t pad = pgb__align(range->beg - pgb__mmap_source.beg, alignment)
+		                 - (size_t)(range->beg - pgb__mmap_source.beg);
+		if (   range->size >= pad
+		    && range->size - pad >= size
+		    && (!best || range->size < best->size))
+			best = range;
+	}
+	if (!best)
+		return NULL;
+
+	page = pgb__mmap_source.beg + pgb__align(best->beg - pgb__mmap_source.beg, alignment);
+	range_end = best->beg + best->size;
+	if (page > best->beg) {
+		best->size = page - best->beg;
+	} else {
+		*best = pgb__mmap_source.free_ranges[--pgb__mmap_source.num_free_ranges];
+	}
+	if (   page + size < range_end
+	    && pgb__mmap_source.num_free_ranges < PGB_MMAP_FREE_RANGES) {
+		pgb__mmap_range_t *rest = &pgb__mmap_source.free_ranges[pgb__mmap_source.num_free_ranges++];
+		rest->beg  = page + size;
+		rest->size = range_end - rest->beg;
+	}
+	return page;
+}
+
+/* Merges a freed range with its free neighbors, or gives it back to the end of
+ * the used part of the reserved range */
+static
+void pgb__mmap_give_free_range(pgb_byte *beg, size_t size)
+{
+	for (size_t i = 0; i < pgb__mmap_source.num_free_ranges; ) {
+		pgb__mmap_range_t *range = &pgb__mmap_source.free_ranges[i];
+		if (range->beg + range->size == beg || beg + size == range->beg) {
+			if (range->beg < beg)
+				beg = range->beg;
+			size += range->size;
+			*range = pgb__mmap_source.free_ranges[--pgb__mmap_source.num_free_ranges];
+		} else {
+			++i;
+		}
+	}
+
+	if (beg + size == pgb__mmap_source.next) {
+		pgb__mmap_source.next = beg;
+	} else if (pgb__mmap_source.num_free_ranges < PGB_MMAP_FREE_RANGES) {
+		pgb__mmap_range_t *range = &pgb__mmap_source.free_ranges[pgb__mmap_source.num_free_ranges++];
+		range->beg  = beg;
+		range->size = size;
+	}
+}
+
+/* Commits a freed or the next unused part of the reserved range, NULL once it
+ * is used up */
+static
+pgb_byte *pgb__mmap_alloc(size_t size)
+{
+	const size_t alignment = size >= PGB_HUGE_PAGE_SIZE ? PGB_HUGE_PAGE_SIZE : pgb__os_page_size();
+	pgb_byte *page = NULL;
+
+	pgb__lock(&pgb__mmap_source.lock);
+	if (!pgb__mmap_source.reserved) {
+		void *range = mmap(NULL, PGB_MMAP_RESERVE, PROT_NONE,
+		                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		pgb__mmap_source.reserved = true;
+		if (range != MAP_FAILED) {
+			pgb__mmap_source.beg  = range;
+			pgb__mmap_source.end  = pgb__mmap_source.beg + PGB_MMAP_RESERVE;
+			pgb__mmap_source.next = pgb__mmap_source.beg;
+		} else {
+			PGB_LOG("pgb: failed to reserve %zu bytes", (size_t)PGB_MMAP_RESERVE);
+		}
+	}
+	if (pgb__mmap_source.next)
+		page = pgb__mmap_take_free_range(size, alignment);
+	if (pgb__mmap_source.next && !page) {
+		pgb_byte *beg = pgb__mmap_source.beg;
+		pgb_byte *aligned = beg + pgb__align(pgb__mmap_source.next - beg, alignment);
+		if (   aligned <= pgb__mmap_source.end
+		    && size <= (size_t)(pgb__mmap_source.end - aligned)) {
+			page = aligned;
+			pgb__mmap_source.next = aligned + size;
+		}
+	}
+	pgb__lock_release(&pgb__mmap_source.lock);
+
+	if (page && mprotect(page, size, PROT_READ | PROT_WRITE) != 0)
+		return NULL;
+#ifdef MADV_HUGEPAGE
+	if (page && size >= PGB_HUGE_PAGE_SIZE)
+		madvise(page, size, MADV_HUGEPAGE);
+#endif
+	return page;
+}
+
+static
+void pgb__mmap_free(pgb_page_t *page)
+{
+	const size_t size = page->size;
+	madvise(page, size, MADV_DONTNEED);
+	mprotect(page, size, PROT_NONE);
+	pgb__lock(&pgb__mmap_source.lock);
+	pgb__mmap_give_free_range((pgb_byte*)page, size);
+	pgb__lock_release(&pgb__mmap_source.lock);
+}
+
+#endif // PGB__MMAP
+
+static
+pgb_page_t *pgb__page_alloc(size_t page_size)
+{
+#ifdef PGB__MMAP
+	pgb_page_t *page = (pgb_page_t*)pgb__mmap_alloc(page_size);
+	if (page)
+		return page;
+#endif
+	return PGB_MALLOC(page_size);
+}
+
+static
+void pgb__page_free(pgb_page_t *page)
+{
+#ifdef PGB__MMAP
+	if (pgb__ptr_in_mmap_source(page)) {
+		pgb__mmap_free(page);
+		return;
+	}
+#endif
+	PGB_FREE(page);
+}
+
+/* Releases the memory of an idle page, except for the header.  Returns false
+ * if the whole page must be freed instead. */
+static
+bool pgb__page_trim(pgb_page_t *page)
+{
+#ifdef PGB__MMAP
+	if (pgb__ptr_in_mmap_source(page)) {
+		const size_t header_size = pgb__align(pgb__header_size(), pgb__os_page_size());
+		if (page->size > header_size)
+			madvise(pgb__page_beg(page) + header_size, page->size - header_size,
+			        MADV_DONTNEED);
+		page->trimmed = true;
+		return true;
+	}
+#endif
+	return false;
+}
+
 static
 pgb_page_t *pgb__page_create(size_t page_size)
 {
-	pgb_page_t *page = PGB_MALLOC(page_size);
+	pgb_page_t *page = pgb__page_alloc(page_size);
 	page->size = page_size;
+	page->idle_gen = 0;
+	page->trimmed = false;
+	page->gprev = NULL;
 	page->gnext = NULL;
 	pgb__page_clear(page);
 	return page;
@@ -302,6 +631,152 @@ void pgb__page_remove(pgb_page_t *page)
 }
 
 
+/* Pool */
+
+static
+void pgb__lock(pgb_lock_t *lock)
+{
+	while (!pgb__lock_try(lock))
+		while (pgb__load_relaxed(*lock))
+			;
+}
+
+static
+size_t pgb__pool_class(size_t page_size)
+{
+	size_t idx = 0;
+	size_t class_size = PGB_MIN_PAGE_SIZE;
+	while (class_size <= page_size / 2 && idx < PGB_POOL_CLASSES - 1) {
+		class_size <<= 1;
+		++idx;
+	}
+	return idx;
+}
+
+void pgb_pool_init(pgb_pool_t *pool)
+{
+	for (size_t i = 0; i < PGB_POOL_CLASSES; ++i) {
+		pool->classes[i].lock = 0;
+		pool->classes[i].first_page = NULL;
+	}
+	pool->generation = 0;
+}
+
+void pgb_pool_destroy(pgb_pool_t *pool)
+{
+	for (size_t i = 0; i < PGB_POOL_CLASSES; ++i) {
+		pgb_page_t *page = pool->classes[i].first_page;
+		while (page) {
+			pgb_page_t *next = page->next;
+			pgb__page_free(page);
+			page = next;
+		}
+		pool->classes[i].first_page = NULL;
+	}
+}
+
+static
+void pgb__pool_give(pgb_pool_t *pool, pgb_page_t *page)
+{
+	pgb_pool_class_t *class_ = &pool->classes[pgb__pool_class(page->size)];
+	page->prev = NULL;
+	page->idle_gen = pgb__load_relaxed(pool->generation);
+	page->trimmed = false;
+	pgb__lock(&class_->lock);
+	page->next = class_->first_page;
+	/* stored atomically for the unsynchronized peek in pgb__pool_take */
+	pgb__store_relaxed(class_->first_page, page);
+	pgb__lock_release(&class_->lock);
+}
+
+static
+pgb_page_t *pgb__pool_take(pgb_pool_t *pool, size_t min_size, size_t max_size)
+{
+	const size_t last = pgb__pool_class(max_size);
+	for (size_t i = pgb__pool_class(min_size); i <= last; ++i) {
+		pgb_pool_class_t *class_ = &pool->classes[i];
+		pgb_page_t *prev = NULL, *page;
+
+		/* unsynchronized peek, so empty classes don't cost a lock */
+		if (!pgb__load_relaxed(class_->first_page))
+			continue;
+
+		pgb__lock(&class_->lock);
+		page = class_->first_page;
+		while (page && (page->size < min_size || page->size > max_size)) {
+			prev = page;
+			page = page->next;
+		}
+		if (page) {
+			if (prev)
+				prev->next = page->next;
+			else
+				pgb__store_relaxed(class_->first_page, page->next);
+		}
+		pgb__lock_release(&class_->lock);
+
+		if (page)
+			return page;
+	}
+	return NULL;
+}
+
+void pgb_pool_advance_gen(pgb_pool_t *pool)
+{
+	const size_t generation = pgb__load_relaxed(pool->generation) + 1;
+	pgb__store_relaxed(pool->generation, generation);
+
+	for (size_t i = 0; i < PGB_POOL_CLASSES; ++i) {
+		pgb_pool_class_t *class_ = &pool->classes[i];
+		pgb_page_t *prev = NULL, *page, *idle = NULL, *trimmed = NULL, *trimmed_last = NULL;
+
+		if (!pgb__load_relaxed(class_->first_page))
+			continue;
+
+		/* idle pages are taken out of the pool, so they can be trimmed or freed
+		 * without holding the lock */
+		pgb__lock(&class_->lock);
+		page = class_->first_page;
+		while (page) {
+			pgb_page_t *next = page->next;
+			if (   !page->trimmed
+			    && generation - page->idle_gen >= PGB_IDLE_GENERATIONS) {
+				if (prev)
+					prev->next = next;
+				else
+					pgb__store_relaxed(class_->first_page, next);
+				page->next = idle;
+				idle = page;
+			} else {
+				prev = page;
+			}
+			page = next;
+		}
+		pgb__lock_release(&class_->lock);
+
+		while (idle) {
+			pgb_page_t *next = idle->next;
+			if (pgb__page_trim(idle)) {
+				idle->next = trimmed;
+				trimmed = idle;
+				if (!trimmed_last)
+					trimmed_last = idle;
+			} else {
+				pgb__page_free(idle);
+			}
+			idle = next;
+		}
+
+		if (trimmed) {
+			pgb__lock(&class_->lock);
+			trimmed_last->next = class_->first_page;
+			pgb__store_relaxed(class_->first_page, trimmed);
+			pgb__lock_release(&class_->lock);
+		}
+	}
+}
+
+
 /* Heap */
 
 void pgb_heap_init(pgb_heap_t *heap)
@@ -309,6 +784,29 @@ void pgb_heap_init(pgb_heap_t *heap)
 	heap->gfirst_page = NULL;
 	heap->glast_page  = NULL;
 	heap->first_page  = NULL;
+	heap->pool        = NULL;
+	heap->num_pages   = 0;
+}
+
+void pgb_heap_init_pooled(pgb_heap_t *heap, pgb_pool_t *pool)
+{
+	pgb_heap_init(heap);
+	heap->pool = pool;
+}
+
+static
+void pgb__heap_remove_page_from_global_list(pgb_heap_t *heap, struct pgb_page *page)
+{
+	if (page->gprev)
+		page->gprev->gnext = page->gnext;
+	else
+		heap->gfirst_page = page->gnext;
+	if (page->gnext)
+		page->gnext->gprev = page->gprev;
+	else
+		heap->glast_page = page->gprev;
+	page->gprev = NULL;
+	page->gnext = NULL;
 }
 
 void pgb_heap_destroy(pgb_heap_t *heap)
@@ -316,12 +814,18 @@ void pgb_heap_destroy(pgb_heap_t *heap)
 	pgb_page_t *page = heap->first_page;
 	while (page) {
 		pgb_page_t *next = page->next;
-		PGB_FREE(page);
+		if (heap->pool) {
+			pgb__heap_remove_page_from_global_list(heap, page);
+			pgb__pool_give(heap->pool, page);
+		} else {
+			pgb__page_free(page);
+		}
 		page = next;
 	}
 	heap->gfirst_page = NULL;
 	heap->glast_page  = NULL;
 	heap->first_page  = NULL;
+	heap->num_pages   = 0;
 }
 
 static
@@ -331,7 +835,10 @@ void pgb__heap_add_page_to_global_list(pgb_heap_t *heap, struct pgb_page *page)
 		heap->gfirst_page = page;
 	else
 		heap->glast_page->gnext = page;
+	page->gprev = heap->glast_page;
 	heap->glast_page = page;
+	while (heap->glast_page->gnext)
+		heap->glast_page = heap->glast_page->gnext;
 }
 
 static
@@ -346,21 +853,43 @@ struct pgb_page *pgb_heap_borrow_page(pgb_heap_t *heap, size_t min_size, size_t
 {
 	if (min_size > max_size)
 		ASSERT_FALSE_AND_LOG("min_size > max_size"); // fall through; result is acceptable
-	
+
 	pgb_page_t *page = heap->first_page;
 	while (page && page->size < min_size)
 		page = page->next;
 
-	if (!page || page->size > max_size)
+	if (!page || page->size > max_size) {
+		if (heap->pool && (page = pgb__pool_take(heap->pool, min_size, max_size))) {
+			pgb__heap_add_page_to_global_list(heap, page);
+			pgb__page_clear(page);
+			return page;
+		}
 		return pgb__heap_create_page(heap, min_size);
+	}
 
 	if (page == heap->first_page)
 		heap->first_page = page->next;
 	pgb__page_remove(page);
 	pgb__page_clear(page);
+	--heap->num_pages;
 	return page;
 }
 
+/* Hands the largest cached page back to the pool */
+static
+void pgb__heap_release_page(pgb_heap_t *heap)
+{
+	pgb_page_t *page = heap->first_page;
+	while (page->next)
+		page = page->next;
+	if (page == heap->first_page)
+		heap->first_page = NULL;
+	pgb__page_remove(page);
+	--heap->num_pages;
+	pgb__heap_remove_page_from_global_list(heap, page);
+	pgb__pool_give(heap->pool, page);
+}
+
 void pgb_heap_return_page(pgb_heap_t *heap, struct pgb_page *page)
 {
 	if (!heap->first_page) {
@@ -386,6 +915,10 @@ void pgb_heap_return_page(pgb_heap_t *heap, struct pgb_page *page)
 		page->prev = prev;
 		page->next = next;
 	}
+	++heap->num_pages;
+
+	if (heap->pool && heap->num_pages > PGB_HEAP_CACHE_PAGES)
+		pgb__heap_release_page(heap);
 }
 
 void pgb_heap_create_page(pgb_heap_t *heap, size_t size)
@@ -407,18 +940,21 @@ bool pgb_heap_has_page(const pgb_heap_t *heap, const struct pgb_page *page)
 void pgb_heap_move_all_pages(pgb_heap_t *dst, pgb_heap_t *src)
 {
 	pgb_page_t *page = src->first_page;
+
+	/* transfer ownership first, dst may hand some of the pages to its pool */
+	if (src->gfirst_page)
+		pgb__heap_add_page_to_global_list(dst, src->gfirst_page);
+
 	while (page) {
 		pgb_page_t *next = page->next;
 		pgb_heap_return_page(dst, page);
 		page = next;
 	}
 
-	if (src->gfirst_page)
-		pgb__heap_add_page_to_global_list(dst, src->gfirst_page);
-
 	src->gfirst_page = NULL;
 	src->glast_page  = NULL;
 	src->first_page  = NULL;
+	src->num_pages   = 0;
 }
 
 
@@ -426,22 +962,30 @@ void pgb_heap_move_all_pages(pgb_heap_t *dst, pgb_heap_t *src)
 
 void pgb_init(pgb_t *pgb, pgb_heap_t *heap)
 {
-	pgb->heap         = heap;
-	pgb->current_page = NULL;
-	pgb->current_ptr  = NULL;
-	pgb->last_mark    = (pgb_watermark_t){0};
+	pgb->heap      = heap;
+	for (size_t i = 0; i < PGB__LANES; ++i) {
+		pgb->lanes[i].page = NULL;
+		pgb->lanes[i].ptr  = NULL;
+	}
+	pgb->last_mark = (pgb_watermark_t){0};
+}
+
+static
+size_t pgb__lane_for_alloc(size_t size)
+{
+	return size <= PGB_SMALL_ALLOC_SIZE ? PGB__LANE_SMALL : PGB__LANE_LARGE;
 }
 
 static
-void pgb__pop_page(pgb_t *pgb)
+void pgb__pop_page(pgb_t *pgb, pgb_lane_t *lane)
 {
-	if (!pgb->current_page) {
+	if (!lane->page) {
 		ASSERT_FALSE_AND_LOG("current_page is NULL");
 		return;
 	}
-	pgb_page_t *prev = pgb->current_page->prev;
-	pgb_heap_return_page(pgb->heap, pgb->current_page);
-	pgb->current_page = prev;
+	pgb_page_t *prev = lane->page->prev;
+	pgb_heap_return_page(pgb->heap, lane->page);
+	lane->page = prev;
 	if (prev)
 		prev->next = NULL;
 }
@@ -449,64 +993,80 @@ void pgb__pop_page(pgb_t *pgb)
 static
 bool pgb__mark_valid(pgb_watermark_t mark)
 {
-	return mark.data.pgb && mark.data.page && mark.data.ptr;
+	if (!mark.data.pgb)
+		return false;
+	for (size_t i = 0; i < PGB__LANES; ++i)
+		if (mark.data.lanes[i].page && mark.data.lanes[i].ptr)
+			return true;
+	return false;
 }
 
 void pgb_destroy(pgb_t *pgb)
 {
 	if (!pgb->heap)
 		ASSERT_FALSE_AND_LOG("heap is NULL");
-	if (pgb->current_page && pgb->current_page->next)
-		ASSERT_FALSE_AND_LOG("destroying with pages unfreed");
+	for (size_t i = 0; i < PGB__LANES; ++i)
+		if (pgb->lanes[i].page && pgb->lanes[i].page->next)
+			ASSERT_FALSE_AND_LOG("destroying with pages unfreed");
 	if (pgb__mark_valid(pgb->last_mark))
 		ASSERT_FALSE_AND_LOG("destroying with last mark still valid");
 
-	while (pgb->current_page)
-		pgb__pop_page(pgb);
+	for (size_t i = 0; i < PGB__LANES; ++i) {
+		while (pgb->lanes[i].page)
+			pgb__pop_page(pgb, &pgb->lanes[i]);
+		pgb->lanes[i].ptr = NULL;
+	}
 
-	pgb->heap         = NULL;
-	pgb->current_page = NULL;
-	pgb->current_ptr  = NULL;
-	pgb->last_mark    = (pgb_watermark_t){0};
+	pgb->heap      = NULL;
+	pgb->last_mark = (pgb_watermark_t){0};
 }
 
 static
-void pgb__add_page(pgb_t *pgb, pgb_page_t *page)
+void pgb__add_page(pgb_lane_t *lane, pgb_page_t *page)
 {
-	if (pgb->current_page)
-		pgb->current_page->next = page;
-	page->prev = pgb->current_page;
-	pgb->current_page = page;
-	pgb->current_ptr = pgb__page_first_usable_slot(page);
+	if (lane->page)
+		lane->page->next = page;
+	page->prev = lane->page;
+	lane->page = page;
+	lane->ptr = pgb__page_first_usable_slot(page);
 }
 
 static
-void pgb__add_page_for_alloc(pgb_t *pgb, size_t alloc_size, size_t *aligned_size)
+void pgb__add_page_for_alloc(pgb_t *pgb, size_t lane_idx, size_t alloc_size,
+                             size_t *aligned_size)
 {
+	pgb_lane_t *lane = &pgb->lanes[lane_idx];
 	const size_t min_page_size = pgb__page_min_size_for_alloc(alloc_size);
-	const size_t max_page_size = pgb__page_max_size_for_alloc(alloc_size);
-	pgb_page_t *page = pgb_heap_borrow_page(pgb->heap, min_page_size, max_page_size);
-	pgb__add_page(pgb, page);
+	size_t max_page_size = pgb__page_max_size_for_alloc(alloc_size);
+	pgb_page_t *page;
+	/* small allocations stay in pages with small slots */
+	if (lane_idx == PGB__LANE_SMALL && max_page_size > PGB_SMALL_PAGE_MAX_SIZE)
+		max_page_size = PGB_SMALL_PAGE_MAX_SIZE;
+	page = pgb_heap_borrow_page(pgb->heap, min_page_size, max_page_size);
+	PGB_ON_ADD_PAGE(page->size);
+	pgb__add_page(lane, page);
 	*aligned_size = pgb__page_align(alloc_size, page);
 }
 
 void *pgb_malloc(size_t size, pgb_t *pgb  MEMCALL_ARGS)
 {
+	const size_t lane_idx = pgb__lane_for_alloc(size);
+	pgb_lane_t *lane = &pgb->lanes[lane_idx];
 	pgb_byte *ptr;
 	size_t aligned_size;
 	if (size == 0)
 		return NULL;
 
-	if (!pgb->current_page) {
-		pgb__add_page_for_alloc(pgb, size, &aligned_size);
+	if (!lane->page) {
+		pgb__add_page_for_alloc(pgb, lane_idx, size, &aligned_size);
 	} else {
-		aligned_size = pgb__page_align(size, pgb->current_page);
-		if (pgb->current_ptr + aligned_size > pgb__page_end(pgb->current_page))
-			pgb__add_page_for_alloc(pgb, size, &aligned_size);
+		aligned_size = pgb__page_align(size, lane->page);
+		if (lane->ptr + aligned_size > pgb__page_end(lane->page))
+			pgb__add_page_for_alloc(pgb, lane_idx, size, &aligned_size);
 	}
-	ptr = pgb->current_ptr;
-	pgb__alloc_set_sz(ptr, pgb->current_page, aligned_size);
-	pgb->current_ptr += aligned_size;
+	ptr = lane->ptr;
+	pgb__alloc_set_sz(ptr, lane->page, aligned_size);
+	lane->ptr += aligned_size;
 	PGB_LOG_ALLOC("pgb", aligned_size  MEMCALL_VARS);
 	return ptr;
 }
@@ -519,41 +1079,62 @@ void *pgb_calloc(size_t nmemb, size_t size, pgb_t *pgb  MEMCALL_ARGS)
 }
 
 static
-bool pgb__find_page_for_ptr(pgb_t *pgb, const void *ptr, pgb_page_t **ppage)
+bool pgb__find_page_for_ptr(pgb_t *pgb, const void *ptr, pgb_page_t **ppage,
+                            size_t *plane)
 {
-	pgb_page_t *page = pgb->current_page;
-	while (page && !pgb__ptr_in_page(ptr, page))
+	/* the current pages hold the allocations most likely to be freed or resized */
+	for (size_t i = 0; i < PGB__LANES; ++i) {
+		pgb_page_t *page = pgb->lanes[i].page;
+		if (page && pgb__ptr_in_page(ptr, page)) {
+			*ppage = page;
+			*plane = i;
+			return true;
+		}
+	}
+	for (size_t i = 0; i < PGB__LANES; ++i) {
+		pgb_page_t *page = pgb->lanes[i].page;
+		if (!page)
+			continue;
 		page = page->prev;
-	if (page)
-		*ppage = page;
-	return page != NULL;
+		while (page && !pgb__ptr_in_page(ptr, page))
+			page = page->prev;
+		if (page) {
+			*ppage = page;
+			*plane = i;
+			return true;
+		}
+	}
+	return false;
 }
 
 static
-void pgb__restore_current_page_ptr(pgb_t *pgb, size_t slot)
+void pgb__restore_current_page_ptr(pgb_lane_t *lane, size_t slot)
 {
-	pgb_page_t *page = pgb->current_page;
+	pgb_page_t *page = lane->page;
 	for (size_t i = slot; i > 0; --i) {
 		if (page->alloc_sizes[i-1] != 0) {
 			pgb_byte *ptr = pgb__slot_get_alloc(page, i-1);
-			pgb->current_ptr = ptr + pgb__alloc_get_sz(ptr, page);
+			lane->ptr = ptr + pgb__alloc_get_sz(ptr, page);
 			return;
 		}
 	}
 	ASSERT_FALSE_AND_LOG("should have encountered header");
-	pgb->current_ptr = pgb__page_first_usable_slot(page);
+	lane->ptr = pgb__page_first_usable_slot(page);
 }
 
 #ifndef NDEBUG
 static
-bool pgb__ptr_freed_by_mark(pgb_watermark_t mark,
+bool pgb__ptr_freed_by_mark(pgb_watermark_t mark, size_t lane_idx,
                             const pgb_page_t *page,
                             const pgb_byte *ptr)
 {
-	if (mark.data.page == page) {
-		return ptr >= mark.data.ptr;
+	const pgb_lane_t *lane = &mark.data.lanes[lane_idx];
+	if (!lane->page) {
+		return true;
+	} else if (lane->page == page) {
+		return ptr >= lane->ptr;
 	} else {
-		for (const pgb_page_t *p = mark.data.page->prev; p; p = p->prev)
+		for (const pgb_page_t *p = lane->page->prev; p; p = p->prev)
 			if (p == page)
 				return false;
 		return true;
@@ -563,27 +1144,32 @@ bool pgb__ptr_freed_by_mark(pgb_watermark_t mark,
 
 bool pgb_has_page(const pgb_t *pgb, const struct pgb_page *page)
 {
-	const pgb_page_t *p = pgb->current_page;
-	while (p && p != page)
-		p = p->prev;
-	return p != NULL;
+	for (size_t i = 0; i < PGB__LANES; ++i) {
+		const pgb_page_t *p = pgb->lanes[i].page;
+		while (p && p != page)
+			p = p->prev;
+		if (p)
+			return true;
+	}
+	return false;
 }
 
 static
 void *pgb__realloc(pgb_byte *ptr, size_t size, pgb_t *pgb  MEMCALL_ARGS)
 {
 	pgb_page_t *page;
+	pgb_lane_t *lane;
+	size_t lane_idx;
 	size_t old_size;
 
-	if (!pgb__find_page_for_ptr(pgb, ptr, &page)) {
+	if (!pgb__find_page_for_ptr(pgb, ptr, &page, &lane_idx)) {
 		ASSERT_FALSE_AND_LOG("memory leak");
 #ifdef PGB_TRACK_MEMORY
 		PGB_LOG("pgb_realloc: memory leak @ %s", loc);
 #endif
 		return NULL;
 	}
-
-	old_size = pgb__alloc_get_sz(ptr, page);
+	lane = &pgb->lanes[lane_idx];
 
 	/* Avoid the case where a pointer was not set to be freed by the last watermark,
 	 * but it will be after reallocation.
@@ -591,17 +1177,17 @@ void *pgb__realloc(pgb_byte *ptr, size_t size, pgb_t *pgb  MEMCALL_ARGS)
 	 * and it doesn't seem worth doing that constantly given the potential harm seems low.
 	 */
 	assert(  !pgb__mark_valid(pgb->last_mark)
-	       || pgb__ptr_freed_by_mark(pgb->last_mark, page, ptr));
+	       || pgb__ptr_freed_by_mark(pgb->last_mark, lane_idx, page, ptr));
 
 	if ((old_size = pgb__alloc_get_sz(ptr, page)) >= size) {
 		return ptr;
-	} else if (   page == pgb->current_page
-	           && ptr + old_size == pgb->current_ptr
-	           &&    ptr + pgb__page_align(size, pgb->current_page)
-	              <= pgb__page_end(pgb->current_page)) {
-		const size_t aligned_size = pgb__page_align(size, pgb->current_page);
-		pgb__alloc_set_sz(ptr, pgb->current_page, aligned_size);
-		pgb->current_ptr = ptr + aligned_size;
+	} else if (   page == lane->page
+	           && ptr + old_size == lane->ptr
+	           && pgb__lane_for_alloc(size) == lane_idx
+	           && ptr + pgb__page_align(size, page) <= pgb__page_end(page)) {
+		const size_t aligned_size = pgb__page_align(size, page);
+		pgb__alloc_set_sz(ptr, page, aligned_size);
+		lane->ptr = ptr + aligned_size;
 		PGB_LOG_REALLOC("pgb", aligned_size  MEMCALL_VARS);
 		return ptr;
 	} else {
@@ -632,19 +1218,22 @@ void pgb_free(void *ptr_, pgb_t *pgb  MEMCALL_ARGS)
 {
 	pgb_byte *ptr = ptr_;
 	pgb_page_t *page;
+	pgb_lane_t *lane;
+	size_t lane_idx;
 	size_t slot;
 	size_t size;
 
 	if (!ptr)
 		return;
 
-	if (!pgb__find_page_for_ptr(pgb, ptr, &page)) {
+	if (!pgb__find_page_for_ptr(pgb, ptr, &page, &lane_idx)) {
 		ASSERT_FALSE_AND_LOG("memory leak");
 #ifdef PGB_TRACK_MEMORY
 		PGB_LOG("pgb_free: memory leak @ %s", loc);
 #endif
 		return;
 	}
+	lane = &pgb->lanes[lane_idx];
 
 	slot = pgb__alloc_get_slot_idx(ptr, page);
 	size = pgb__alloc_get_sz(ptr, page);
@@ -652,17 +1241,17 @@ void pgb_free(void *ptr_, pgb_t *pgb  MEMCALL_ARGS)
 		ASSERT_FALSE_AND_LOG("freeing 0 size page");
 	pgb__alloc_set_sz(ptr, page, 0);
 
-	if (ptr + size == pgb->current_ptr) {
-		pgb__restore_current_page_ptr(pgb, slot);
-		while (   pgb->current_page
-		       && pgb->current_ptr == pgb__page_first_usable_slot(pgb->current_page)) {
-			pgb__pop_page(pgb);
-			if (pgb->current_page)
-				pgb__restore_current_page_ptr(pgb, PGB__PAGE_SLOTS);
+	if (ptr + size == lane->ptr) {
+		pgb__restore_current_page_ptr(lane, slot);
+		while (   lane->page
+		       && lane->ptr == pgb__page_first_usable_slot(lane->page)) {
+			pgb__pop_page(pgb, lane);
+			if (lane->page)
+				pgb__restore_current_page_ptr(lane, PGB__PAGE_SLOTS);
 			else
-				pgb->current_ptr = NULL;
+				lane->ptr = NULL;
 		}
-	} else if (page == pgb->current_page) {
+	} else if (page == lane->page) {
 #ifdef PGB_ANALYZE
 		PGB_LOG("pgb_free: %u bytes out of order @ %s", size, loc);
 #endif
@@ -676,13 +1265,11 @@ void pgb_free(void *ptr_, pgb_t *pgb  MEMCALL_ARGS)
 pgb_watermark_t pgb_save(pgb_t *pgb)
 {
 	pgb_watermark_t mark = {
-		.data = {
-			.pgb  = pgb,
-			.page = pgb->current_page,
-			.ptr  = pgb->current_ptr,
-		},
+		.data = { .pgb = pgb },
 		.prev = pgb->last_mark.data,
 	};
+	for (size_t i = 0; i < PGB__LANES; ++i)
+		mark.data.lanes[i] = pgb->lanes[i];
 	pgb->last_mark.data = mark.data;
 	return mark;
 }
@@ -690,14 +1277,17 @@ pgb_watermark_t pgb_save(pgb_t *pgb)
 void pgb_restore(pgb_watermark_t watermark)
 {
 	pgb_t *pgb = watermark.data.pgb;
-	while (pgb->current_page != watermark.data.page)
-		pgb__pop_page(pgb);
-	pgb->current_page = watermark.data.page;
-	pgb->current_ptr  = watermark.data.ptr;
-	if (pgb->current_page) {
-		const size_t slot = pgb__alloc_get_slot_idx(pgb->current_ptr, pgb->current_page);
-		memset(&pgb->current_page->alloc_sizes[slot], 0, PGB__PAGE_SLOTS - slot);
-		pgb->current_page->next = NULL;
+	for (size_t i = 0; i < PGB__LANES; ++i) {
+		pgb_lane_t *lane = &pgb->lanes[i];
+		const pgb_lane_t *mark = &watermark.data.lanes[i];
+		while (lane->page != mark->page)
+			pgb__pop_page(pgb, lane);
+		lane->ptr = mark->ptr;
+		if (lane->page) {
+			const size_t slot = pgb__alloc_get_slot_idx(lane->ptr, lane->page);
+			memset(&lane->page->alloc_sizes[slot], 0, PGB__PAGE_SLOTS - slot);
+			lane->page->next = NULL;
+		}
 	}
 	pgb->last_mark.data = watermark.prev;
 }
@@ -705,7 +1295,8 @@ void pgb_restore(pgb_watermark_t watermark)
 size_t pgb_alloc_size(const pgb_t *pgb, const void *ptr)
 {
 	pgb_page_t *page;
-	return pgb__find_page_for_ptr((pgb_t*)pgb, ptr, &page)
+	size_t lane_idx;
+	return pgb__find_page_for_ptr((pgb_t*)pgb, ptr, &page, &lane_idx)
 	     ? pgb__alloc_get_sz(ptr, page) : 0;
 }
 
@@ -716,16 +1307,18 @@ void pgb_stats(const pgb_t *pgb, size_t *bytes_used, size_t *pages_used,
 
 	*bytes_used = 0;
 	*pages_used = 0;
-	page = pgb->current_page;
-	if (page) {
-		*bytes_used += pgb->current_ptr - pgb__page_first_usable_slot(page);
-		++*pages_used;
-		page = page->prev;
-	}
-	while (page) {
-		*bytes_used += page->size;
-		++*pages_used;
-		page = page->prev;
+	for (size_t i = 0; i < PGB__LANES; ++i) {
+		page = pgb->lanes[i].page;
+		if (page) {
+			*bytes_used += pgb->lanes[i].ptr - pgb__page_first_usable_slot(page);
+			++*pages_used;
+			page = page->prev;
+		}
+		while (page) {
+			*bytes_used += page->size;
+			++*pages_used;
+			page = page->prev;
+		}
 	}
 
 	*bytes_available = 0;
@@ -741,30 +1334,36 @@ void pgb_stats(const pgb_t *pgb, size_t *bytes_used, size_t *pages_used,
 void pgb_watermark_stats(pgb_watermark_t mark, size_t *bytes_used, size_t *pages_used)
 {
 	pgb_t *pgb = mark.data.pgb;
-	pgb_page_t *page = pgb->current_page;
 
 	*bytes_used = 0;
 	*pages_used = 0;
 
-	if (page && page != mark.data.page) {
-		*bytes_used += pgb->current_ptr - pgb__page_first_usable_slot(page);
-		*pages_used += 1;
-		page = page->prev;
-	}
+	for (size_t i = 0; i < PGB__LANES; ++i) {
+		const pgb_lane_t *lane = &pgb->lanes[i];
+		const pgb_lane_t *lane_mark = &mark.data.lanes[i];
+		pgb_page_t *page = lane->page;
 
-	while (page && page != mark.data.page) {
-		*bytes_used += page->size;
-		*pages_used += 1;
-		page = page->prev;
-	}
+		if (page && page != lane_mark->page) {
+			*bytes_used += lane->ptr - pgb__page_first_usable_slot(page);
+			*pages_used += 1;
+			page = page->prev;
+		}
 
-	if (page != mark.data.page) {
-		*bytes_used = 0;
-		*pages_used = 0;
-		ASSERT_FALSE_AND_LOG("mark page not found");
-	} else if (page) {
-		*bytes_used += pgb__page_end(page) - mark.data.ptr;
-		*pages_used += 1;
+		while (page && page != lane_mark->page) {
+			*bytes_used += page->size;
+			*pages_used += 1;
+			page = page->prev;
+		}
+
+		if (page != lane_mark->page) {
+			*bytes_used = 0;
+			*pages_used = 0;
+			ASSERT_FALSE_AND_LOG("mark page not found");
+			return;
+		} else if (page) {
+			*bytes_used += pgb__page_end(page) - lane_mark->ptr;
+			*pages_used += 1;
+		}
 	}
 }
 
@@ -1,22 +1,102 @@
 #ifndef VIOLET_PROFILER_H
 #define VIOLET_PROFILER_H
 
-#define PROFILE_BLOCK_COUNT 32
+/* Each thread keeps its open blocks in a call tree, whose nodes are allocated
+ * in chunks of this many blocks as needed */
+#ifndef PROFILE_BLOCK_CHUNK
+#define PROFILE_BLOCK_CHUNK 64
+#endif
+
+/* While tracing, each thread records block begins & ends in a ring buffer of
+ * this many records, which profile_dump_trace writes as Chrome trace-event
+ * JSON (viewable in chrome://tracing or Perfetto) */
+#ifndef PROFILE_TRACE_CAPACITY
+#define PROFILE_TRACE_CAPACITY 16384
+#endif
 
+#ifndef PROFILE_MAX_THREADS
+#define PROFILE_MAX_THREADS 32
+#endif
+
+/* Every block's duration is counted per call path in a log-linear histogram,
+ * 8 buckets per power of two of ticks, so percentiles are within 12.5% */
+#define PROFILE_HISTOGRAM_BUCKETS 320
+
+/* The PROFILE_ macros declare one of these per call site, so the id is only
+ * hashed the first time the site is reached */
+typedef struct profile_site
+{
+	const char *name;
+	u32 id;
+} profile_site_t;
+
+/* Durations of one call path, merged across threads by profile_collect */
+typedef struct profile_stat
+{
+	const char *name; /* non-owned */
+	u32 path;
+	u32 parent_path; /* 0 for roots */
+	u32 depth;
+	u32 count;
+	u64 ticks;
+	u64 max_ticks;
+	u64 allocs; /* through the allocators counted by g_alloc_counters */
+	u64 alloc_bytes;
+	u64 alloc_pages;
+	u32 histogram[PROFILE_HISTOGRAM_BUCKETS];
+} profile_stat_t;
+
+void profile_site_begin(profile_site_t *site);
 void profile_block_begin(const char *name);
 void profile_block_end(const char *name);
 void profile_aggregate(void);
 void profile_reset(void);
+/* also releases the calling thread's blocks & its thread slot, e.g. before
+ * the thread exits */
 void profile_clear_all(void);
+/* frees every thread's slot & trace, along with the collected stats;
+ * only call once no other thread is profiling, e.g. at exit */
+void profile_destroy(void);
+
+void profile_trace_start(void);
+void profile_trace_stop(void);
+/* best called while other threads aren't profiling, e.g. after profile_trace_stop */
+b32  profile_dump_trace(const char *path);
+
+/* Threads publish their stats when a root block ends, once their previous
+ * publish has been collected.  profile_collect merges the published stats into
+ * the current window, and should only be called from one thread, e.g. once per
+ * frame.  The window accumulates until profile_clear_stats. */
+void profile_collect(void);
+const profile_stat_t *profile_stats(u32 *count);
+u32  profile_stat_percentile_us(const profile_stat_t *stat, u32 percentile);
+u32  profile_stat_max_us(const profile_stat_t *stat);
+void profile_log_stats(void);
+void profile_clear_stats(void);
+
+#define PROFILE__CONCAT_(a, b) a##b
+#define PROFILE__CONCAT(a, b)  PROFILE__CONCAT_(a, b)
+#define PROFILE__SITE          PROFILE__CONCAT(profile__site_, __LINE__)
 
 #ifdef PROFILE
-#define PROFILE_BLOCK_BEGIN(name)           profile_block_begin(#name)
+#define PROFILE_BLOCK_BEGIN(name) \
+	static profile_site_t PROFILE__SITE = { #name }; \
+	profile_site_begin(&PROFILE__SITE)
 #define PROFILE_BLOCK_END(name)             profile_block_end(#name)
-#define PROFILE_FUNCTION_BEGIN()            profile_block_begin(__FUNCTION__)
+#define PROFILE_FUNCTION_BEGIN() \
+	static profile_site_t PROFILE__SITE = { __FUNCTION__ }; \
+	profile_site_begin(&PROFILE__SITE)
 #define PROFILE_FUNCTION_END()              profile_block_end(__FUNCTION__)
 #define PROFILE_AGGREGATE()                 profile_aggregate()
 #define PROFILE_RESET()                     profile_reset()
 #define PROFILE_CLEAR_ALL()                 profile_clear_all()
+#define PROFILE_DESTROY()                   profile_destroy()
+#define PROFILE_TRACE_START()               profile_trace_start()
+#define PROFILE_TRACE_STOP()                profile_trace_stop()
+#define PROFILE_DUMP_TRACE(path)            profile_dump_trace(path)
+#define PROFILE_COLLECT()                   profile_collect()
+#define PROFILE_LOG_STATS()                 profile_log_stats()
+#define PROFILE_CLEAR_STATS()               profile_clear_stats()
 #else
 #define PROFILE_BLOCK_BEGIN(name)           NOOP
 #define PROFILE_BLOCK_END(name)             NOOP
@@ -25,89 +105,644 @@ void profile_clear_all(void);
 #define PROFILE_AGGREGATE()                 NOOP
 #define PROFILE_RESET()                     NOOP
 #define PROFILE_CLEAR_ALL()                 NOOP
+#define PROFILE_DESTROY()                   NOOP
+#define PROFILE_TRACE_START()               NOOP
+#define PROFILE_TRACE_STOP()                NOOP
+#define PROFILE_DUMP_TRACE(path)            NOOP
+#define PROFILE_COLLECT()                   NOOP
+#define PROFILE_LOG_STATS()                 NOOP
+#define PROFILE_CLEAR_STATS()               NOOP
 #endif
 
 #endif // VIOLET_PROFILER_H
 
 #ifdef PROFILER_IMPLEMENTATION
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/* Clock */
+
+/* Blocks are timed with the TSC where available, which is converted to time
+ * using the interval since the first block against timepoint_create. */
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define profile__ticks() ((u64)__rdtsc())
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define profile__ticks() ((u64)__rdtsc())
+#else
+#define profile__ticks() profile__nanoseconds()
+#define PROFILE__TICKS_ARE_NANOSECONDS
+#endif
+
+static
+u64 profile__nanoseconds(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER counter, frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return (u64)(counter.QuadPart / frequency.QuadPart) * 1000000000
+	     + (u64)(counter.QuadPart % frequency.QuadPart) * 1000000000 / frequency.QuadPart;
+#else
+	const timepoint_t t = timepoint_create();
+	return (u64)t.tv_sec * 1000000000 + (u64)t.tv_nsec;
+#endif
+}
+
+static struct
+{
+	u64 ticks;
+	u64 nanoseconds;
+} g_profile_clock_base = {0};
+
+static
+void profile__clock_init(void)
+{
+	if (!g_profile_clock_base.ticks) {
+		g_profile_clock_base.nanoseconds = profile__nanoseconds();
+		g_profile_clock_base.ticks       = profile__ticks();
+	}
+}
+
+static
+double profile__nanoseconds_per_tick(void)
+{
+#ifdef PROFILE__TICKS_ARE_NANOSECONDS
+	return 1.0;
+#else
+	u64 ticks, nanoseconds;
+	profile__clock_init();
+	nanoseconds = profile__nanoseconds();
+	ticks       = profile__ticks();
+	/* never waits for the interval to be measurable, so durations right after
+	 * the first block are less accurate */
+	if (ticks <= g_profile_clock_base.ticks)
+		return 1.0;
+	return (double)(nanoseconds - g_profile_clock_base.nanoseconds)
+	     / (double)(ticks - g_profile_clock_base.ticks);
+#endif
+}
+
+/* Blocks */
+
 typedef struct profile__block
 {
-	const char *name; /* non-owned, only NULL for unused blocks */
+	const char *name; /* non-owned */
 	u32 id;
-	u32 microseconds;
+	u32 path; /* combined ids of the block & its ancestors */
 	u32 count;
 	u32 depth;
 	b32 aggregate;
-	timepoint_t last_start;
+	u32 stat; /* index into the thread's stats, valid for stats_generation */
+	u32 stats_generation;
+	u64 ticks;
+	u64 last_start;
+	alloc_counters_t allocs; /* made while the block was open */
+	alloc_counters_t allocs_start;
 	struct profile__block *parent; /* non-owned, only NULL for root */
 	struct profile__block *child; /* non-owned, can be NULL */
-	struct profile__block *sibling; /* non-owned, can be NULL */
+	struct profile__block *sibling; /* non-owned, can be NULL; links the free list */
 } profile__block_t;
 
-thread_local profile__block_t g_profiler_blocks[PROFILE_BLOCK_COUNT] = {0};
+typedef struct profile__block_chunk
+{
+	struct profile__block_chunk *next;
+	profile__block_t blocks[PROFILE_BLOCK_CHUNK];
+} profile__block_chunk_t;
+
+thread_local profile__block_chunk_t *g_profiler_chunks = NULL;
+thread_local profile__block_t *g_profiler_free_blocks = NULL;
 thread_local profile__block_t *g_profiler_block_last = NULL; /* NULL at frame start */
 
+/* Threads */
+
+#if defined(_MSC_VER)
+#define profile__atomic_cas(p, old, new) \
+	(_InterlockedCompareExchange((volatile long*)(p), new, old) == (long)(old))
+/* aligned word accesses are atomic & ordered on the platforms msvc targets */
+#define profile__load_acquire(p)      (p)
+#define profile__store_release(p, v)  ((p) = (v))
+#define profile__atomic_cas_ptr(p, old, new) \
+	(_InterlockedCompareExchangePointer((void *volatile*)(p), new, old) == (old))
+#define profile__atomic_swap_ptr(p, v) _InterlockedExchangePointer((void *volatile*)(p), v)
+#else
+#define profile__atomic_cas(p, old, new) \
+	__atomic_compare_exchange_n(p, &(old), new, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)
+#define profile__load_acquire(p)      __atomic_load_n(&(p), __ATOMIC_ACQUIRE)
+#define profile__store_release(p, v)  __atomic_store_n(&(p), v, __ATOMIC_RELEASE)
+#define profile__atomic_cas_ptr(p, old, new) \
+	__atomic_compare_exchange_n(p, &(old), new, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)
+#define profile__atomic_swap_ptr(p, v) __atomic_exchange_n(p, v, __ATOMIC_ACQUIRE)
+#endif
+
+typedef struct profile__trace profile__trace_t;
+
+typedef struct profile__thread
+{
+	u32 tid;
+	volatile b32 publishing; /* stats were published & not yet collected */
+	volatile b32 released; /* by profile_clear_all, so another thread can take the slot */
+	profile__trace_t *volatile trace; /* NULL until the thread is traced */
+} profile__thread_t;
+
+/* threads' records outlive them, so their traces can still be dumped, until
+ * another thread takes over the slot or profile_destroy */
+static profile__thread_t *volatile g_profile_threads[PROFILE_MAX_THREADS] = {0};
+static volatile u32 g_profile_thread_count = 0;
+thread_local profile__thread_t *g_profile_thread = NULL;
+thread_local b32 g_profile_thread_refused = false;
+
 static
-b32 profile__block_find(u32 id, profile__block_t **block)
+profile__thread_t *profile__thread(void)
 {
-	for (u32 i = 0; i < countof(g_profiler_blocks); ++i) {
-		if (   g_profiler_blocks[i].id == id
-		    && g_profiler_blocks[i].parent == g_profiler_block_last) {
-			*block = &g_profiler_blocks[i];
-			return true;
+	u32 count;
+
+	if (g_profile_thread || g_profile_thread_refused)
+		return g_profile_thread;
+
+	/* a released slot is reused once its last stats were collected */
+	count = profile__load_acquire(g_profile_thread_count);
+	for (u32 i = 0; i < count; ++i) {
+		profile__thread_t *thread = profile__load_acquire(g_profile_threads[i]);
+		b32 released = true;
+		if (   thread
+		    && !profile__load_acquire(thread->publishing)
+		    && profile__atomic_cas(&thread->released, released, false)) {
+			g_profile_thread = thread;
+			return thread;
+		}
+	}
+
+	do {
+		count = g_profile_thread_count;
+		if (count >= PROFILE_MAX_THREADS) {
+			g_profile_thread_refused = true;
+			ASSERT_FALSE_AND_LOG("too many threads to profile");
+			return NULL;
 		}
+	} while (!profile__atomic_cas(&g_profile_thread_count, count, count + 1));
+
+	g_profile_thread = acalloc(1, sizeof(profile__thread_t), g_allocator);
+	g_profile_thread->tid = count;
+	profile__store_release(g_profile_threads[count], g_profile_thread);
+	return g_profile_thread;
+}
+
+/* Trace */
+
+typedef struct profile__trace_record
+{
+	const char *name; /* non-owned */
+	u64 ticks;
+	b32 begin;
+	u32 allocs; /* made during the block, only for ends */
+	u32 alloc_pages;
+	u64 alloc_bytes;
+} profile__trace_record_t;
+
+struct profile__trace
+{
+	volatile u64 head; /* total records written; the last CAPACITY are kept */
+	profile__trace_record_t records[PROFILE_TRACE_CAPACITY];
+};
+
+static volatile b32 g_profile_tracing = false;
+static u64 g_profile_trace_start = 0;
+
+static
+profile__trace_t *profile__trace_for_thread(void)
+{
+	profile__thread_t *thread = profile__thread();
+	if (!thread)
+		return NULL;
+	if (!thread->trace)
+		profile__store_release(thread->trace,
+		                       (profile__trace_t*)acalloc(1, sizeof(profile__trace_t), g_allocator));
+	return thread->trace;
+}
+
+static
+void profile__trace_record(const char *name, b32 begin, u64 ticks,
+                           const alloc_counters_t *allocs)
+{
+	profile__trace_t *trace = profile__trace_for_thread();
+	if (trace) {
+		const u64 head = trace->head;
+		profile__trace_record_t *record = &trace->records[head % PROFILE_TRACE_CAPACITY];
+		record->name        = name;
+		record->ticks       = ticks;
+		record->begin       = begin;
+		record->allocs      = allocs ? (u32)allocs->allocs : 0;
+		record->alloc_pages = allocs ? (u32)allocs->pages : 0;
+		record->alloc_bytes = allocs ? allocs->bytes : 0;
+		profile__store_release(trace->head, head + 1);
 	}
-	return false;
+}
+
+void profile_trace_start(void)
+{
+	profile__clock_init();
+	g_profile_trace_start = profile__ticks();
+	g_profile_tracing = true;
+}
+
+void profile_trace_stop(void)
+{
+	g_profile_tracing = false;
 }
 
 static
-b32 profile__block_find_empty(profile__block_t **block)
+void profile__trace_write_name(FILE *fp, const char *name)
+{
+	for (const char *c = name; *c; ++c) {
+		if (*c == '"' || *c == '\\')
+			fputc('\\', fp);
+		if ((u8)*c >= 0x20)
+			fputc(*c, fp);
+	}
+}
+
+b32 profile_dump_trace(const char *path)
 {
-	for (u32 i = 0; i < countof(g_profiler_blocks); ++i) {
-		if (g_profiler_blocks[i].name == NULL) {
-			*block = &g_profiler_blocks[i];
-			return true;
+	const u32 num_threads = profile__load_acquire(g_profile_thread_count);
+	const double ns_per_tick = profile__nanoseconds_per_tick();
+	b32 first = true;
+	FILE *fp = file_open(path, "w");
+	if (!fp) {
+		log_error("failed to open trace file '%s'", path);
+		return false;
+	}
+
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", fp);
+	for (u32 i = 0; i < num_threads; ++i) {
+		const profile__thread_t *thread = profile__load_acquire(g_profile_threads[i]);
+		const profile__trace_t *trace = thread ? profile__load_acquire(thread->trace) : NULL;
+		if (!trace)
+			continue;
+
+		const u64 head = profile__load_acquire(trace->head);
+		const u64 tail = head > PROFILE_TRACE_CAPACITY ? head - PROFILE_TRACE_CAPACITY : 0;
+
+		fprintf(fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+		            "\"args\":{\"name\":\"thread %u\"}}", first ? "" : ",", thread->tid, thread->tid);
+		first = false;
+
+		for (u64 j = tail; j < head; ++j) {
+			const profile__trace_record_t *record = &trace->records[j % PROFILE_TRACE_CAPACITY];
+			u64 ns;
+			/* the rings aren't reset, so they may still hold earlier sessions */
+			if (record->ticks < g_profile_trace_start)
+				continue;
+			ns = (u64)((double)(record->ticks - g_profile_trace_start) * ns_per_tick);
+			fputs(",\n{\"name\":\"", fp);
+			profile__trace_write_name(fp, record->name);
+			fprintf(fp, "\",\"ph\":\"%c\",\"ts\":%llu.%03u,\"pid\":1,\"tid\":%u",
+			        record->begin ? 'B' : 'E', (unsigned long long)(ns / 1000),
+			        (u32)(ns % 1000), thread->tid);
+			/* end event args are merged into the slice's args */
+			if (!record->begin)
+				fprintf(fp, ",\"args\":{\"allocs\":%u,\"alloc_bytes\":%llu,\"alloc_pages\":%u}",
+				        record->allocs, (unsigned long long)record->alloc_bytes,
+				        record->alloc_pages);
+			fputc('}', fp);
 		}
 	}
-	return false;
+	fputs("\n]}\n", fp);
+
+	if (ferror(fp)) {
+		log_error("failed to write trace file '%s'", path);
+		fclose(fp);
+		return false;
+	}
+	fclose(fp);
+	return true;
 }
 
+/* Stats */
+
+typedef struct profile__stats
+{
+	struct profile__stats *next; /* links published stats */
+	profile__thread_t *thread; /* non-owned */
+	array(profile_stat_t) stats;
+	u32 *slots; /* open addressed by path, holding the stat index + 1 */
+	u32 num_slots;
+} profile__stats_t;
+
+/* threads push their stats onto this list, which profile_collect takes whole */
+static profile__stats_t *volatile g_profile_published = NULL;
+static profile__stats_t *g_profile_collected = NULL;
+thread_local profile__stats_t *g_profile_stats = NULL;
+thread_local u32 g_profile_stats_generation = 1;
+
 static
-b32 profiler__block_in_siblings(const profile__block_t *siblings,
-                                const profile__block_t *block)
+u32 profile__log2(u64 x)
 {
-	while (siblings && block != siblings)
-		siblings = siblings->sibling;
-	return siblings != NULL;
+#if defined(_MSC_VER)
+	unsigned long idx;
+	if (x >> 32) {
+		_BitScanReverse(&idx, (unsigned long)(x >> 32));
+		return (u32)idx + 32;
+	}
+	_BitScanReverse(&idx, (unsigned long)x);
+	return (u32)idx;
+#else
+	return 63 - (u32)__builtin_clzll(x);
+#endif
 }
 
-void profile_block_begin(const char *name)
+static
+u32 profile__histogram_bucket(u64 ticks)
 {
-	const u32 id = hash_compute(name);
-	profile__block_t *block = NULL;
+	u32 exponent;
+	if (ticks < 8)
+		return (u32)ticks;
+	exponent = profile__log2(ticks);
+	return min((exponent - 2) * 8 + (u32)((ticks >> (exponent - 3)) & 7),
+	           PROFILE_HISTOGRAM_BUCKETS - 1);
+}
 
-	if (   !profile__block_find(id, &block)
-	    && !profile__block_find_empty(&block)) {
-		assert(false);
+static
+u64 profile__histogram_bucket_max(u32 bucket)
+{
+	const u32 exponent = bucket / 8 + 2;
+	if (bucket < 8)
+		return bucket;
+	return ((u64)(8 + bucket % 8 + 1) << (exponent - 3)) - 1;
+}
+
+static
+profile__stats_t *profile__stats_create(void)
+{
+	profile__stats_t *stats = acalloc(1, sizeof(profile__stats_t), g_allocator);
+	stats->stats = array_create();
+	return stats;
+}
+
+static
+void profile__stats_destroy(profile__stats_t *stats)
+{
+	array_destroy(stats->stats);
+	if (stats->slots)
+		afree(stats->slots, g_allocator);
+	afree(stats, g_allocator);
+}
+
+static
+void profile__stats_insert_slot(profile__stats_t *stats, u32 path, u32 idx)
+{
+	const u32 mask = stats->num_slots - 1;
+	u32 slot = path & mask;
+	while (stats->slots[slot])
+		slot = (slot + 1) & mask;
+	stats->slots[slot] = idx + 1;
+}
+
+static
+u32 profile__stats_find(profile__stats_t *stats, u32 path, const char *name,
+                        u32 parent_path, u32 depth)
+{
+	profile_stat_t *stat;
+	u32 mask, slot;
+
+	if (2 * (array_sz(stats->stats) + 1) > stats->num_slots) {
+		afree(stats->slots, g_allocator);
+		stats->num_slots = max(stats->num_slots * 2, 64u);
+		stats->slots = acalloc(stats->num_slots, sizeof(stats->slots[0]), g_allocator);
+		array_iterate(stats->stats, i, n)
+			profile__stats_insert_slot(stats, stats->stats[i].path, i);
+	}
+
+	mask = stats->num_slots - 1;
+	for (slot = path & mask; stats->slots[slot]; slot = (slot + 1) & mask)
+		if (stats->stats[stats->slots[slot] - 1].path == path)
+			return stats->slots[slot] - 1;
+
+	stats->slots[slot] = array_sz(stats->stats) + 1;
+	stat = array_append_null(stats->stats);
+	memclr(*stat);
+	stat->name        = name;
+	stat->path        = path;
+	stat->parent_path = parent_path;
+	stat->depth       = depth;
+	return array_sz(stats->stats) - 1;
+}
+
+static
+void profile__stats_merge(profile__stats_t *dst, const profile__stats_t *src)
+{
+	array_foreach(src->stats, profile_stat_t, stat) {
+		const u32 idx = profile__stats_find(dst, stat->path, stat->name,
+		                                    stat->parent_path, stat->depth);
+		profile_stat_t *merged = &dst->stats[idx];
+		merged->count    += stat->count;
+		merged->ticks    += stat->ticks;
+		merged->max_ticks = max(merged->max_ticks, stat->max_ticks);
+		merged->allocs   += stat->allocs;
+		merged->alloc_bytes += stat->alloc_bytes;
+		merged->alloc_pages += stat->alloc_pages;
+		for (u32 i = 0; i < PROFILE_HISTOGRAM_BUCKETS; ++i)
+			merged->histogram[i] += stat->histogram[i];
+	}
+}
+
+static
+void profile__stats_record(profile__block_t *block, u64 ticks, const alloc_counters_t *allocs)
+{
+	profile_stat_t *stat;
+
+	if (!g_profile_stats)
+		g_profile_stats = profile__stats_create();
+
+	/* the index is only looked up again after the stats were published */
+	if (block->stats_generation != g_profile_stats_generation) {
+		block->stat = profile__stats_find(g_profile_stats, block->path, block->name,
+		                                  block->parent ? block->parent->path : 0,
+		                                  block->depth);
+		block->stats_generation = g_profile_stats_generation;
+	}
+
+	stat = &g_profile_stats->stats[block->stat];
+	stat->count     += 1;
+	stat->ticks     += ticks;
+	stat->max_ticks  = max(stat->max_ticks, ticks);
+	stat->allocs    += allocs->allocs;
+	stat->alloc_bytes += allocs->bytes;
+	stat->alloc_pages += allocs->pages;
+	stat->histogram[profile__histogram_bucket(ticks)] += 1;
+}
+
+/* Hands the thread's stats to the collector & starts new ones.  Unless forced,
+ * waits for the previous stats to be collected, so an idle collector doesn't
+ * accumulate a list of stats per frame. */
+static
+void profile__stats_publish(b32 force)
+{
+	profile__stats_t *stats = g_profile_stats, *head;
+	profile__thread_t *thread = profile__thread();
+
+	if (!stats || !thread || (!force && profile__load_acquire(thread->publishing)))
 		return;
+
+	stats->thread = thread;
+	thread->publishing = true;
+	do {
+		head = g_profile_published;
+		stats->next = head;
+	} while (!profile__atomic_cas_ptr(&g_profile_published, head, stats));
+
+	g_profile_stats = NULL;
+	g_profile_stats_generation += 1;
+}
+
+void profile_collect(void)
+{
+	const alloc_counters_t allocs = g_alloc_counters;
+	profile__stats_t *stats = profile__atomic_swap_ptr(&g_profile_published, NULL);
+
+	if (!g_profile_collected)
+		g_profile_collected = profile__stats_create();
+
+	while (stats) {
+		profile__stats_t *next = stats->next;
+		profile__stats_merge(g_profile_collected, stats);
+		profile__store_release(stats->thread->publishing, false);
+		profile__stats_destroy(stats);
+		stats = next;
+	}
+
+	g_alloc_counters = allocs;
+}
+
+const profile_stat_t *profile_stats(u32 *count)
+{
+	*count = g_profile_collected ? array_sz(g_profile_collected->stats) : 0;
+	return g_profile_collected ? g_profile_collected->stats : NULL;
+}
+
+static
+u32 profile__ticks_to_us(u64 ticks)
+{
+	return (u32)((double)ticks * profile__nanoseconds_per_tick() / 1000.0);
+}
+
+u32 profile_stat_percentile_us(const profile_stat_t *stat, u32 percentile)
+{
+	const u64 rank = max(((u64)stat->count * percentile + 99) / 100, 1ull);
+	u64 seen = 0;
+
+	if (!stat->count)
+		return 0;
+
+	for (u32 i = 0; i < PROFILE_HISTOGRAM_BUCKETS; ++i) {
+		seen += stat->histogram[i];
+		if (seen >= rank)
+			return profile__ticks_to_us(min(profile__histogram_bucket_max(i), stat->max_ticks));
+	}
+	return profile_stat_max_us(stat);
+}
+
+u32 profile_stat_max_us(const profile_stat_t *stat)
+{
+	return profile__ticks_to_us(stat->max_ticks);
+}
+
+void profile_log_stats(void)
+{
+	u32 count;
+	const profile_stat_t *stats = profile_stats(&count);
+	for (u32 i = 0; i < count; ++i) {
+		const profile_stat_t *stat = &stats[i];
+		log_info("PROFILE: %*s%s p50 = %u us, p95 = %u us, p99 = %u us, max = %u us (%u)"
+		         " allocs = %llu (%llu bytes, %llu pages)",
+		         stat->depth, "", stat->name,
+		         profile_stat_percentile_us(stat, 50), profile_stat_percentile_us(stat, 95),
+		         profile_stat_percentile_us(stat, 99), profile_stat_max_us(stat), stat->count,
+		         (unsigned long long)stat->allocs, (unsigned long long)stat->alloc_bytes,
+		         (unsigned long long)stat->alloc_pages);
 	}
+}
 
-	block->name       = name;
-	block->id         = id;
-	block->depth      = 0;
-	block->aggregate  = false;
-	block->last_start = timepoint_create();
-	block->parent     = g_profiler_block_last;
-	if (g_profiler_block_last) {
-		block->depth      = g_profiler_block_last->depth + 1;
-		block->aggregate  = g_profiler_block_last->aggregate;
-		if (!profiler__block_in_siblings(g_profiler_block_last->child, block)) {
-			block->sibling  = g_profiler_block_last->child;
-			g_profiler_block_last->child = block;
+void profile_clear_stats(void)
+{
+	if (g_profile_collected) {
+		profile__stats_destroy(g_profile_collected);
+		g_profile_collected = NULL;
+	}
+}
+
+static
+profile__block_t *profile__block_alloc(void)
+{
+	profile__block_t *block;
+
+	if (!g_profiler_free_blocks) {
+		profile__block_chunk_t *chunk = amalloc(sizeof(profile__block_chunk_t), g_allocator);
+		chunk->next = g_profiler_chunks;
+		g_profiler_chunks = chunk;
+		for (u32 i = 0; i < PROFILE_BLOCK_CHUNK; ++i) {
+			chunk->blocks[i].sibling = g_profiler_free_blocks;
+			g_profiler_free_blocks = &chunk->blocks[i];
 		}
 	}
+
+	block = g_profiler_free_blocks;
+	g_profiler_free_blocks = block->sibling;
+	memclr(*block);
+	return block;
+}
+
+static
+void profile__block_begin(const char *name, u32 id)
+{
+	/* the profiler's own allocations aren't attributed to blocks */
+	const alloc_counters_t allocs = g_alloc_counters;
+	profile__block_t *parent = g_profiler_block_last;
+	profile__block_t *block = parent ? parent->child : NULL;
+
+	/* aggregated blocks are revisited under the same parent */
+	while (block && block->id != id)
+		block = block->sibling;
+
+	if (!block) {
+		block = profile__block_alloc();
+		block->id     = id;
+		block->path   = ((parent ? parent->path : 0) ^ id) * 0x01000193;
+		block->parent = parent;
+		if (parent) {
+			block->sibling = parent->child;
+			parent->child  = block;
+		}
+	}
+
+	block->name      = name;
+	block->depth     = parent ? parent->depth + 1 : 0;
+	block->aggregate = parent ? parent->aggregate : false;
 	g_profiler_block_last = block;
+
+	if (g_profile_tracing)
+		profile__trace_record(name, true, profile__ticks(), NULL);
+
+	g_alloc_counters    = allocs;
+	block->allocs_start = allocs;
+	block->last_start   = profile__ticks();
+}
+
+void profile_site_begin(profile_site_t *site)
+{
+	if (!site->id) {
+		profile__clock_init();
+		site->id = hash_compute(site->name);
+	}
+	profile__block_begin(site->name, site->id);
+}
+
+void profile_block_begin(const char *name)
+{
+	profile__clock_init();
+	profile__block_begin(name, hash_compute(name));
 }
 
 static
@@ -134,21 +769,24 @@ void profile__block_reverse_children(profile__block_t *block)
 }
 
 static
-void profile__block_log(const profile__block_t *block)
+void profile__block_log(const profile__block_t *block, double ns_per_tick)
 {
+	const u32 microseconds = (u32)((double)block->ticks * ns_per_tick / 1000.0);
 	profile__block_t *child = block->child;
 	while (child) {
-		profile__block_log(child);
+		profile__block_log(child, ns_per_tick);
 		child = child->sibling;
 	}
 
 #ifdef DEBUG
 	/* try to make it extra clear that these are debug timings */
-	log_debug("PROFILE: %*s%s = %s us (%u) [DEBUG]", block->depth, "", block->name,
-	          imprint_u32(block->microseconds), block->count);
+	log_debug("PROFILE: %*s%s = %s us (%u) allocs = %zu (%zu bytes, %zu pages) [DEBUG]",
+	          block->depth, "", block->name, imprint_u32(microseconds), block->count,
+	          block->allocs.allocs, block->allocs.bytes, block->allocs.pages);
 #else
-	log_info("PROFILE: %*s%s = %s us (%u)", block->depth, "", block->name,
-	         imprint_u32(block->microseconds), block->count);
+	log_info("PROFILE: %*s%s = %s us (%u) allocs = %zu (%zu bytes, %zu pages)",
+	         block->depth, "", block->name, imprint_u32(microseconds), block->count,
+	         block->allocs.allocs, block->allocs.bytes, block->allocs.pages);
 #endif
 }
 
@@ -162,24 +800,37 @@ void profile__block_clear(profile__block_t *block)
 		child = sibling;
 	}
 
-	memclr(*block);
+	block->sibling = g_profiler_free_blocks;
+	g_profiler_free_blocks = block;
 }
 
 void profile_block_end(const char *name)
 {
-	const timepoint_t end = timepoint_create();
-	const u32 id = hash_compute(name);
+	const u64 end = profile__ticks();
+	const alloc_counters_t counters = g_alloc_counters;
 	profile__block_t *block = g_profiler_block_last;
+	alloc_counters_t allocs;
 
 	assert(block);
 
-	if (block->id != id) {
+	/* names from the same call site are usually the same pointer */
+	if (!block || (block->name != name && strcmp(block->name, name) != 0)) {
 		assert(false);
 		return;
 	}
 
-	block->count        += 1;
-	block->microseconds += timepoint_diff_micro(block->last_start, end);
+	allocs.allocs = counters.allocs - block->allocs_start.allocs;
+	allocs.bytes  = counters.bytes  - block->allocs_start.bytes;
+	allocs.pages  = counters.pages  - block->allocs_start.pages;
+
+	block->count += 1;
+	block->ticks += end - block->last_start;
+	block->allocs.allocs += allocs.allocs;
+	block->allocs.bytes  += allocs.bytes;
+	block->allocs.pages  += allocs.pages;
+	profile__stats_record(block, end - block->last_start, &allocs);
+	if (g_profile_tracing)
+		profile__trace_record(name, false, end, &allocs);
 
 	g_profiler_block_last = block->parent;
 
@@ -188,13 +839,18 @@ void profile_block_end(const char *name)
 		if (block->child)
 			profile__block_reverse_children(block);
 
-		profile__block_log(block);
+		profile__block_log(block, profile__nanoseconds_per_tick());
 
 		if (g_profiler_block_last)
 			g_profiler_block_last->child = block->sibling;
 
 		profile__block_clear(block);
 	}
+
+	if (!g_profiler_block_last)
+		profile__stats_publish(false);
+
+	g_alloc_counters = counters;
 }
 
 void profile_aggregate(void)
@@ -215,8 +871,50 @@ void profile_reset(void)
 
 void profile_clear_all(void)
 {
-	arrclr(g_profiler_blocks);
+	while (g_profiler_chunks) {
+		profile__block_chunk_t *next = g_profiler_chunks->next;
+		afree(g_profiler_chunks, g_allocator);
+		g_profiler_chunks = next;
+	}
+	g_profiler_free_blocks = NULL;
 	g_profiler_block_last = NULL;
+
+	/* whatever the thread measured since its last publish still gets collected */
+	profile__stats_publish(true);
+	if (g_profile_stats) {
+		profile__stats_destroy(g_profile_stats);
+		g_profile_stats = NULL;
+	}
+
+	if (g_profile_thread) {
+		profile__store_release(g_profile_thread->released, true);
+		g_profile_thread = NULL;
+	}
+	g_profile_thread_refused = false;
+}
+
+void profile_destroy(void)
+{
+	profile__stats_t *stats;
+
+	profile_clear_all();
+
+	stats = profile__atomic_swap_ptr(&g_profile_published, NULL);
+	while (stats) {
+		profile__stats_t *next = stats->next;
+		profile__stats_destroy(stats);
+		stats = next;
+	}
+	profile_clear_stats();
+
+	for (u32 i = 0; i < g_profile_thread_count; ++i) {
+		if (g_profile_threads[i]) {
+			afree(g_profile_threads[i]->trace, g_allocator);
+			afree(g_profile_threads[i], g_allocator);
+			g_profile_threads[i] = NULL;
+		}
+	}
+	g_profile_thread_count = 0;
 }
 
 #undef PROFILER_IMPLEMENTATION
@@ -112,6 +112,18 @@ void save_screenshot(box2i bounds, const char *filename);
 #define WINDOW_FONT_FILE_PATH "Roboto.ttf"
 #endif
 
+/* Glyphs of all fonts are rasterized on first use into a shared atlas.
+ * The atlas grows by adding fixed size pages, so the texture coordinates of
+ * glyphs already handed out never change. */
+#ifndef SDL_GL_FONT_ATLAS_DIM
+#define SDL_GL_FONT_ATLAS_DIM 1024
+#endif
+
+typedef struct font_atlas font_atlas_t;
+
+font_atlas_t *font_atlas_create(void);
+void          font_atlas_destroy(font_atlas_t *atlas);
+
 typedef struct font_t
 {
 	const char *filename;
@@ -119,12 +131,15 @@ typedef struct font_t
 	s32 size;
 	s32 num_glyphs;
 	gui_font_metrics_t metrics;
-	void *char_info;
-	void *index_map;
-	gui_texture_t texture;
+	r32 scale;
+	void *file; /* the ttf, shared by all sizes of the font in the atlas */
+	void *info; /* the file's stbtt_fontinfo */
+	void *glyphs;
+	font_atlas_t *atlas;
+	struct font_t *next;
 } font_t;
 
-b32  font_load(font_t *f, const char *filename, s32 size);
+b32  font_load(font_t *f, const char *filename, s32 size, font_atlas_t *atlas);
 void font_destroy(font_t *f);
 
 typedef enum window_flags
@@ -705,355 +720,674 @@ void save_screenshot(box2i bounds, const char *filename)
 	afree(bytes_flip, g_allocator);
 }
 
-/* copied + modified from stbtt_PackFontRangesGatherRects */
-static
-void vltt_PackFontAllGatherRects(stbtt_pack_context *spc, const stbtt_fontinfo *info,
-                                 int font_size, stbrp_rect *rects)
-{
-	int missing_glyph_added = 0;
-	float fh = font_size;
-	float scale = fh > 0 ? stbtt_ScaleForPixelHeight(info, fh)
-	                     : stbtt_ScaleForMappingEmToPixels(info, -fh);
-
-	for (int glyph = 0; glyph < info->numGlyphs; ++glyph) {
-		int x0,y0,x1,y1;
-		if (glyph == 0 && (spc->skip_missing || missing_glyph_added)) {
-			rects[glyph].w = rects[glyph].h = 0;
-		} else {
-			stbtt_GetGlyphBitmapBoxSubpixel(info,glyph,
-			                                scale * spc->h_oversample,
-			                                scale * spc->v_oversample,
-			                                0,0,
-			                                &x0,&y0,&x1,&y1);
-			rects[glyph].w = (stbrp_coord) (x1-x0 + spc->padding + spc->h_oversample-1);
-			rects[glyph].h = (stbrp_coord) (y1-y0 + spc->padding + spc->v_oversample-1);
-			if (glyph == 0)
-				missing_glyph_added = 1;
-		}
-	}
-}
+/* Font atlas */
 
-/* copied + modified from stbtt_PackFontRangesRenderIntoRects */
-static
-int vltt_PackFontAllRenderIntoRects(stbtt_pack_context *spc, const stbtt_fontinfo *info,
-                                    int font_size, stbrp_rect *rects,
-                                    stbtt_packedchar *chardata, int *num_unpacked)
-{
-	int missing_glyph = -1, return_value = 1;
-	float fh = font_size;
-	float scale = fh > 0 ? stbtt_ScaleForPixelHeight(info, fh)
-	                     : stbtt_ScaleForMappingEmToPixels(info, -fh);
-
-	*num_unpacked = 0;
-
-	for (int glyph = 0; glyph < info->numGlyphs; ++glyph) {
-		float recip_h,recip_v,sub_x,sub_y;
-		recip_h = 1.0f / spc->h_oversample;
-		recip_v = 1.0f / spc->v_oversample;
-		sub_x = stbtt__oversample_shift(spc->h_oversample);
-		sub_y = stbtt__oversample_shift(spc->v_oversample);
-		stbrp_rect *r = &rects[glyph];
-		if (r->was_packed && r->w != 0 && r->h != 0) {
-			stbtt_packedchar *bc = &chardata[glyph];
-			int advance, lsb, x0,y0,x1,y1;
-			stbrp_coord pad = (stbrp_coord) spc->padding;
-
-			// pad on left and top
-			r->x += pad;
-			r->y += pad;
-			r->w -= pad;
-			r->h -= pad;
-			stbtt_GetGlyphHMetrics(info, glyph, &advance, &lsb);
-			stbtt_GetGlyphBitmapBox(info, glyph,
-			                        scale * spc->h_oversample,
-			                        scale * spc->v_oversample,
-			                        &x0,&y0,&x1,&y1);
-			stbtt_MakeGlyphBitmapSubpixel(info,
-			                              spc->pixels + r->x + r->y*spc->stride_in_bytes,
-			                              r->w - spc->h_oversample+1,
-			                              r->h - spc->v_oversample+1,
-			                              spc->stride_in_bytes,
-			                              scale * spc->h_oversample,
-			                              scale * spc->v_oversample,
-			                              0,0,
-			                              glyph);
-
-			if (spc->h_oversample > 1)
-				stbtt__h_prefilter(spc->pixels + r->x + r->y*spc->stride_in_bytes,
-				                   r->w, r->h, spc->stride_in_bytes,
-				                   spc->h_oversample);
-
-			if (spc->v_oversample > 1)
-				stbtt__v_prefilter(spc->pixels + r->x + r->y*spc->stride_in_bytes,
-				                   r->w, r->h, spc->stride_in_bytes,
-				                   spc->v_oversample);
-
-			bc->x0       = (stbtt_int16)  r->x;
-			bc->y0       = (stbtt_int16)  r->y;
-			bc->x1       = (stbtt_int16) (r->x + r->w);
-			bc->y1       = (stbtt_int16) (r->y + r->h);
-			bc->xadvance =                scale * advance;
-			bc->xoff     =       (float)  x0 * recip_h + sub_x;
-			bc->yoff     =       (float)  y0 * recip_v + sub_y;
-			bc->xoff2    =                (x0 + r->w) * recip_h + sub_x;
-			bc->yoff2    =                (y0 + r->h) * recip_v + sub_y;
-
-			if (glyph == 0)
-				missing_glyph = glyph;
-		} else if (spc->skip_missing) {
-			return_value = 0;
-			++*num_unpacked;
-		} else if (r->was_packed && r->w == 0 && r->h == 0 && missing_glyph >= 0) {
-			chardata[glyph] = chardata[missing_glyph];
-		} else {
-			return_value = 0; // if any fail, report failure
-			++*num_unpacked;
-		}
-	}
+#define SDL_GL_FONT_OVERSAMPLE_H 3
+#define SDL_GL_FONT_PADDING      1
 
-	return return_value;
-}
+#ifdef __EMSCRIPTEN__
+#define SDL_GL_FONT_ATLAS_BPP 2
+#else
+#define SDL_GL_FONT_ATLAS_BPP 1
+#endif
 
-/* Instead of packing individual ranges, pack all the codepoints that are in the file.
- * Since the stbtt interface wasn't designed for this use, I had to copy+paste+refactor
- * a few functions from the library.  A cleaner approach would be to build a list
- * of ranges from the font's character mapping, but I don't understand the TTF file
- * format well enough to do that.
- *
- * This function is copied + modified from stbtt_PackFontRanges */
-static
-int vltt_PackFontAll(stbtt_pack_context *spc, stbtt_fontinfo *info,
-                     int font_size, stbtt_packedchar *chardata, int *num_unpacked)
+typedef struct font_atlas_page
 {
-	const int n = info->numGlyphs;
-	int return_value = 1;
-	stbrp_rect *rects;
+	gui_texture_t texture;
+	stbrp_context packer;
+	stbrp_node nodes[SDL_GL_FONT_ATLAS_DIM];
+} font_atlas_page_t;
 
-	// flag all characters as NOT packed
-	for (int i = 0; i < n; ++i)
-		chardata[i].x0 = chardata[i].y0 = chardata[i].x1 = chardata[i].y1 = 0;
+typedef struct font_file
+{
+	u32 path_hash;
+	u32 refs;
+	void *ttf;
+	stbtt_fontinfo info;
+} font_file_t;
 
-	rects = STBTT_malloc(sizeof(*rects) * n, spc->user_allocator_context);
-	if (!rects)
-		return 0;
+typedef struct font_atlas
+{
+	/* pages are never moved, stbrp_context points into itself */
+	array(font_atlas_page_t*) pages;
+	/* loaded once per path & released when the last size using them is destroyed */
+	array(font_file_t*) files;
+} font_atlas_t;
 
-	vltt_PackFontAllGatherRects(spc, info, font_size, rects);
+typedef enum font_glyph_state
+{
+	FONT_GLYPH_UNLOADED,
+	FONT_GLYPH_LOADED,
+	FONT_GLYPH_FAILED,
+} font_glyph_state_e;
 
-	stbtt_PackFontRangesPackRects(spc, rects, n);
+typedef struct font_glyph_t
+{
+	stbtt_packedchar packed;
+	u16 page;
+	u16 state;
+} font_glyph_t;
 
-	return_value = vltt_PackFontAllRenderIntoRects(spc, info, font_size, rects, chardata, num_unpacked);
+font_atlas_t *font_atlas_create(void)
+{
+	font_atlas_t *atlas = amalloc(sizeof(font_atlas_t), g_allocator);
+	atlas->pages = array_create();
+	atlas->files = array_create();
+	return atlas;
+}
 
-	STBTT_free(rects, spc->user_allocator_context);
-	return return_value;
+void font_atlas_destroy(font_atlas_t *atlas)
+{
+	array_foreach(atlas->pages, font_atlas_page_t*, page) {
+		texture_destroy(&(*page)->texture);
+		afree(*page, g_allocator);
+	}
+	array_destroy(atlas->pages);
+	assert(array_empty(atlas->files));
+	array_destroy(atlas->files);
+	afree(atlas, g_allocator);
 }
 
 static
-int vltt_PackFont(stbtt_fontinfo *info, int font_size, stbtt_packedchar *chardata, gui_texture_t *tex)
+font_atlas_page_t *font_atlas__add_page(font_atlas_t *atlas)
 {
+	const s32 dim = SDL_GL_FONT_ATLAS_DIM;
+	temp_memory_mark_t mark = temp_memory_save(g_temp_allocator);
+	font_atlas_page_t *page = amalloc(sizeof(font_atlas_page_t), g_allocator);
+	u8 *bitmap = amalloc(dim * dim * SDL_GL_FONT_ATLAS_BPP, g_temp_allocator);
+
+	stbrp_init_target(&page->packer, dim, dim, page->nodes, dim);
+
 #ifdef __EMSCRIPTEN__
-	const s32 bpp = 2;
+	for (s32 i = 0; i < dim * dim; ++i) {
+		bitmap[i * 2] = ~0;
+		bitmap[i * 2 + 1] = 0;
+	}
+	texture_init(&page->texture, dim, dim, GL_LUMINANCE_ALPHA, bitmap);
 #else
-	const s32 bpp = 1;
+	/* NOTE(rgriege): otherwise bitmap has noise at the bottom */
+	memset(bitmap, 0, dim * dim);
+	texture_init(&page->texture, dim, dim, GL_RED, bitmap);
+	GL_CHECK(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_ONE);
+	GL_CHECK(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_ONE);
+	GL_CHECK(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_ONE);
+	GL_CHECK(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, GL_RED);
 #endif
-	temp_memory_mark_t mark = temp_memory_save(g_temp_allocator);
-	unsigned char *bitmap = NULL;
-	s32 w = 512, h = 512;
-	s32 h_oversample = 3;
-	stbtt_pack_context context;
-	b32 packed = false, failed = false;
-	s32 num_unpacked = 0;
-
-	while (!packed && !failed) {
-		temp_memory_restore(mark);
-		bitmap = amalloc(w * h * bpp, g_temp_allocator);
-		/* NOTE(rgriege): otherwise bitmap has noise at the bottom */
-		memset(bitmap, 0, w * h * bpp);
 
-		if ((failed = !stbtt_PackBegin(&context, bitmap, w, h, w * bpp, 1, g_temp_allocator)))
-			break;
+	temp_memory_restore(mark);
+	array_append(atlas->pages, page);
+	return page;
+}
 
-		stbtt_PackSetOversampling(&context, h_oversample, 1);
+/* Only the newest page is packed into - older pages are considered full. */
+static
+b32 font_atlas__pack(font_atlas_t *atlas, stbrp_rect *rect, u16 *page_idx)
+{
+	font_atlas_page_t *page;
 
-		if (vltt_PackFontAll(&context, info, font_size, chardata, &num_unpacked)) {
-			stbtt_PackEnd(&context); // not really necessary, handled by memory mark
-			packed = true;
-		} else {
-			const s32 num_glyphs_packed = info->numGlyphs - num_unpacked;
-			s32 est_glyphs_packed = num_glyphs_packed;
-			s32 est_glyphs_packed_prev;
-			do {
-				est_glyphs_packed_prev = est_glyphs_packed;
-				if (w < 2048) {
-					w *= 2;
-					est_glyphs_packed *= 2;
-				} else if (h_oversample > 1) {
-					const s32 old_h_oversample = h_oversample;
-					h_oversample = 1;
-					est_glyphs_packed *= old_h_oversample;
-				} else if (h < 2048) {
-					h *= 2;
-					est_glyphs_packed *= 2;
-				}
-			} while (   est_glyphs_packed < info->numGlyphs / 2
-			         && est_glyphs_packed > est_glyphs_packed_prev);
-			// fail on fonts needing too large a texture,
-			// but try one last time if we've changed a parameter
-			failed = (est_glyphs_packed == num_glyphs_packed);
-		}
+	if (rect->w > SDL_GL_FONT_ATLAS_DIM || rect->h > SDL_GL_FONT_ATLAS_DIM)
+		return false;
+
+	if (array_sz(atlas->pages) > 0) {
+		page = array_last(atlas->pages);
+		if (stbrp_pack_rects(&page->packer, rect, 1) && rect->was_packed)
+			goto out;
 	}
 
-	if (packed) {
+	page = font_atlas__add_page(atlas);
+	if (!stbrp_pack_rects(&page->packer, rect, 1) || !rect->was_packed)
+		return false;
+
+out:
+	*page_idx = array_sz(atlas->pages) - 1;
+	return true;
+}
+
+static
+void font_atlas__upload(font_atlas_page_t *page, s32 x, s32 y, s32 w, s32 h,
+                        const u8 *bitmap)
+{
+	texture_bind(&page->texture);
+	GL_CHECK(glPixelStorei, GL_UNPACK_ALIGNMENT, 1);
 #ifdef __EMSCRIPTEN__
-		unsigned char *row = amalloc(w * bpp, g_temp_allocator);
-		for (s32 r = 0; r < h; ++r) {
-			memset(row, ~0, w * bpp);
-			for (s32 c = 0; c < w; ++c)
-				row[c * bpp + bpp - 1] = bitmap[r * w * bpp + c];
-			memcpy(&bitmap[r * w * bpp], row, w * bpp);
+	{
+		temp_memory_mark_t mark = temp_memory_save(g_temp_allocator);
+		u8 *la = amalloc(w * h * 2, g_temp_allocator);
+		for (s32 i = 0; i < w * h; ++i) {
+			la[i * 2] = ~0;
+			la[i * 2 + 1] = bitmap[i];
 		}
-		texture_init(tex, w, h, GL_LUMINANCE_ALPHA, bitmap);
+		GL_CHECK(glTexSubImage2D, GL_TEXTURE_2D, 0, x, y, w, h,
+		         GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, la);
+		temp_memory_restore(mark);
+	}
 #else
-		texture_init(tex, w, h, GL_RED, bitmap);
-		GL_CHECK(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_ONE);
-		GL_CHECK(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_ONE);
-		GL_CHECK(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_ONE);
-		GL_CHECK(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, GL_RED);
+	GL_CHECK(glTexSubImage2D, GL_TEXTURE_2D, 0, x, y, w, h,
+	         GL_RED, GL_UNSIGNED_BYTE, bitmap);
 #endif
-	}
-
-	temp_memory_restore(mark);
-	return packed;
+	GL_CHECK(glPixelStorei, GL_UNPACK_ALIGNMENT, 4);
+	texture_unbind();
 }
 
-/* See https://docs.microsoft.com/en-us/typography/opentype/spec/cmap */
+/* Based on stbtt_PackFontRangesGatherRects & stbtt_PackFontRangesRenderIntoRects,
+ * for a single glyph packed into the shared atlas. */
 static
-size_t font__index_map_size(const stbtt_fontinfo *info)
-{
-	stbtt_uint8 *data = info->data;
-	stbtt_uint32 index_map = info->index_map;
-	stbtt_uint16 format = ttUSHORT(data + index_map + 0);
-
-	if (format == 0) { // byte encoding table
-		return ttUSHORT(data + index_map + 2);
-	} else if (format == 2) { // high-byte mapping through table
-		return ttUSHORT(data + index_map + 2);
-	} else if (format == 4) { // segment mapping to delta values
-		return ttUSHORT(data + index_map + 2);
-	} else if (format == 6) { // trimmed table mapping
-		return ttUSHORT(data + index_map + 2);
-	} else if (format == 8) { // mixed 16-bit and 32-bit coverage
-		return ttULONG(data + index_map + 4);
-	} else if (format == 10) { // trimmed array
-		return ttULONG(data + index_map + 4);
-	} else if (format == 12) { // segmented coverage
-		return ttULONG(data + index_map + 4);
-	} else if (format == 13) { // many-to-one range mappings
-		return ttULONG(data + index_map + 4);
-	} else if (format == 14) { // unicode variation sequences
-		return ttULONG(data + index_map + 2);
-	} else {
-		assert(0);
-		return 0;
+b32 font__rasterize_glyph(font_t *f, int index, font_glyph_t *glyph)
+{
+	const stbtt_fontinfo *info = f->info;
+	const s32 h_oversample = SDL_GL_FONT_OVERSAMPLE_H;
+	const s32 v_oversample = 1;
+	const s32 pad = SDL_GL_FONT_PADDING;
+	const r32 recip_h = 1.f / h_oversample;
+	const r32 recip_v = 1.f / v_oversample;
+	const r32 sub_x = stbtt__oversample_shift(h_oversample);
+	const r32 sub_y = stbtt__oversample_shift(v_oversample);
+	temp_memory_mark_t mark;
+	stbrp_rect rect = {0};
+	int advance, lsb, x0, y0, x1, y1;
+	s32 w, h;
+	u8 *bitmap;
+
+	stbtt_GetGlyphHMetrics(info, index, &advance, &lsb);
+	stbtt_GetGlyphBitmapBoxSubpixel(info, index,
+	                                f->scale * h_oversample,
+	                                f->scale * v_oversample,
+	                                0, 0, &x0, &y0, &x1, &y1);
+	rect.w = (stbrp_coord)(x1 - x0 + pad + h_oversample - 1);
+	rect.h = (stbrp_coord)(y1 - y0 + pad + v_oversample - 1);
+
+	if (!font_atlas__pack(f->atlas, &rect, &glyph->page)) {
+		log_error("failed to pack glyph %d of %s:%d", index, f->filename, f->size);
+		return false;
 	}
-}
 
-static
-void font__index_map_copy(font_t *f, const stbtt_fontinfo *info, allocator_t *alloc)
-{
-	stbtt_uint8 *data = info->data;
-	stbtt_uint32 index_map = info->index_map;
-	size_t size = font__index_map_size(info);
+	/* pad on left and top */
+	rect.x += pad;
+	rect.y += pad;
+	w = rect.w - pad;
+	h = rect.h - pad;
+
+	mark = temp_memory_save(g_temp_allocator);
+	bitmap = amalloc(w * h, g_temp_allocator);
+	memset(bitmap, 0, w * h);
+	stbtt_GetGlyphBitmapBox(info, index,
+	                        f->scale * h_oversample,
+	                        f->scale * v_oversample,
+	                        &x0, &y0, &x1, &y1);
+	stbtt_MakeGlyphBitmapSubpixel(info, bitmap,
+	                              w - h_oversample + 1,
+	                              h - v_oversample + 1,
+	                              w,
+	                              f->scale * h_oversample,
+	                              f->scale * v_oversample,
+	                              0, 0, index);
+	if (h_oversample > 1)
+		stbtt__h_prefilter(bitmap, w, h, w, h_oversample);
+	if (v_oversample > 1)
+		stbtt__v_prefilter(bitmap, w, h, w, v_oversample);
+	font_atlas__upload(f->atlas->pages[glyph->page], rect.x, rect.y, w, h, bitmap);
+	temp_memory_restore(mark);
 
-	f->index_map = amalloc(size, alloc);
-	memcpy(f->index_map, data + index_map, size);
+	glyph->packed.x0       = (stbtt_int16)  rect.x;
+	glyph->packed.y0       = (stbtt_int16)  rect.y;
+	glyph->packed.x1       = (stbtt_int16) (rect.x + w);
+	glyph->packed.y1       = (stbtt_int16) (rect.y + h);
+	glyph->packed.xadvance =                f->scale * advance;
+	glyph->packed.xoff     =       (float)  x0 * recip_h + sub_x;
+	glyph->packed.yoff     =       (float)  y0 * recip_v + sub_y;
+	glyph->packed.xoff2    =                (x0 + w) * recip_h + sub_x;
+	glyph->packed.yoff2    =                (y0 + h) * recip_v + sub_y;
+	return true;
 }
 
 static
-int font__get_index_for_codepoint(const font_t *f, s32 codepoint)
-{
-	/* NOTE(rgriege): kinda hacky - only works as long as stbtt_FindGlyphIndex
-	 * doesn't use any other fields from info.  Storing our own hash map instead
-	 * of the TTF's index map may be faster & more robust. */
-	stbtt_fontinfo info = {
-		.data = f->index_map,
-		.index_map = 0,
-	};
-	return stbtt_FindGlyphIndex(&info, codepoint);
+const font_glyph_t *font__get_glyph(font_t *f, int index)
+{
+	font_glyph_t *glyph = &((font_glyph_t*)f->glyphs)[index];
+	if (glyph->state == FONT_GLYPH_UNLOADED)
+		glyph->state = font__rasterize_glyph(f, index, glyph)
+		             ? FONT_GLYPH_LOADED : FONT_GLYPH_FAILED;
+	return glyph->state == FONT_GLYPH_LOADED ? glyph : NULL;
 }
 
-
-b32 font_load(font_t *f, const char *filename, s32 size)
+static
+font_file_t *font_atlas__acquire_file(font_atlas_t *atlas, const char *filename, u32 path_hash)
 {
-	b32 retval = false;
-	stbtt_fontinfo info = { .userdata = g_temp_allocator };
-	int ascent, descent, line_gap;
-	r32 scale;
-	void *ttf;
+	font_file_t *file;
 
-	f->char_info = NULL;
+	array_foreach(atlas->files, font_file_t*, existing) {
+		if ((*existing)->path_hash == path_hash) {
+			++(*existing)->refs;
+			return *existing;
+		}
+	}
 
-	if (!(ttf = file_read_all(filename, "rb", NULL, g_temp_allocator))) {
+	file = acalloc(1, sizeof(font_file_t), g_allocator);
+	if (!(file->ttf = file_read_all(filename, "rb", NULL, g_allocator))) {
 		log_error("failed to read font file '%s'", filename);
-		goto out;
+		goto err;
 	}
 
-	if (!stbtt_InitFont(&info, ttf, stbtt_GetFontOffsetForIndex(ttf, 0))) {
+	file->info.userdata = g_allocator;
+	if (!stbtt_InitFont(&file->info, file->ttf, stbtt_GetFontOffsetForIndex(file->ttf, 0))) {
 		log_error("failed to initialize font file '%s'", filename);
-		goto err_ttf;
+		goto err;
 	}
 
-	f->num_glyphs = info.numGlyphs;
-	log_debug("packing %d glyphs for %s:%d", f->num_glyphs, filename, size);
-	f->char_info = amalloc(f->num_glyphs * sizeof(stbtt_packedchar), g_allocator);
+	file->path_hash = path_hash;
+	file->refs = 1;
+	array_append(atlas->files, file);
+	return file;
 
-	if (!vltt_PackFont(&info, size, f->char_info, &f->texture)) {
-		log_error("failed to pack font %s:%d", filename, size);
-		goto err_pack;
+err:
+	if (file->ttf)
+		afree(file->ttf, g_allocator);
+	afree(file, g_allocator);
+	return NULL;
+}
+
+static
+void font_atlas__release_file(font_atlas_t *atlas, font_file_t *file)
+{
+	if (--file->refs > 0)
+		return;
+
+	array_iterate(atlas->files, i, n) {
+		if (atlas->files[i] == file) {
+			array_remove_fast(atlas->files, i);
+			break;
+		}
 	}
+	afree(file->ttf, g_allocator);
+	afree(file, g_allocator);
+}
+
+b32 font_load(font_t *f, const char *filename, s32 size, font_atlas_t *atlas)
+{
+	const u32 path_hash = hash_compute(filename);
+	font_file_t *file;
+	int ascent, descent, line_gap;
+
+	f->file = NULL;
+	f->info = NULL;
+	f->glyphs = NULL;
+	f->atlas = atlas;
 
-	font__index_map_copy(f, &info, g_allocator);
+	if (!(file = font_atlas__acquire_file(atlas, filename, path_hash)))
+		return false;
 
+	f->file = file;
+	f->info = &file->info;
 	f->filename = filename;
-	f->path_hash = hash_compute(filename);
+	f->path_hash = path_hash;
 	f->size = size;
-	stbtt_GetFontVMetrics(&info, &ascent, &descent, &line_gap);
-	scale = stbtt_ScaleForPixelHeight(&info, size);
-	f->metrics.ascent = scale * ascent;
-	f->metrics.descent = scale * descent;
-	f->metrics.line_gap = scale * line_gap;
-	f->metrics.newline_dist = scale * (ascent - descent + line_gap);
-	retval = true;
-
-err_pack:
-	if (!retval)
-		afree(f->char_info, g_allocator);
-err_ttf:
-	afree(ttf, g_temp_allocator);
-out:
-	return retval;
+	f->num_glyphs = file->info.numGlyphs;
+	f->glyphs = acalloc(f->num_glyphs, sizeof(font_glyph_t), g_allocator);
+	stbtt_GetFontVMetrics(&file->info, &ascent, &descent, &line_gap);
+	f->scale = stbtt_ScaleForPixelHeight(&file->info, size);
+	f->metrics.ascent = f->scale * ascent;
+	f->metrics.descent = f->scale * descent;
+	f->metrics.line_gap = f->scale * line_gap;
+	f->metrics.newline_dist = f->scale * (ascent - descent + line_gap);
+	return true;
 }
 
 void font_destroy(font_t *f)
 {
-	afree(f->index_map, g_allocator);
-	afree(f->char_info, g_allocator);
-	texture_destroy(&f->texture);
+	if (f->glyphs)
+		afree(f->glyphs, g_allocator);
+	if (f->file)
+		font_atlas__release_file(f->atlas, f->file);
+	f->glyphs = f->info = f->file = NULL;
+}
+
+/* Stream buffer
+ * A GL buffer with room for several frames of data, written front to back.
+ * Each frame lands in a region the GPU is no longer reading, so it can be
+ * written without synchronizing.  Once the end is reached, the storage is
+ * orphaned and writing restarts at the front. */
+
+#ifndef SDL_GL_STREAM_FRAMES
+#define SDL_GL_STREAM_FRAMES 3
+#endif
+
+#define SDL_GL_STREAM_ALIGN 16
+
+typedef struct gl_stream_buffer
+{
+	u32 handle;
+	GLenum target;
+	size_t size;
+	size_t offset;
+} gl_stream_buffer_t;
+
+static
+void gl_stream_buffer_init(gl_stream_buffer_t *buf, GLenum target)
+{
+	GL_CHECK(glGenBuffers, 1, &buf->handle);
+	buf->target = target;
+	buf->size = 0;
+	buf->offset = 0;
+}
+
+static
+void gl_stream_buffer_destroy(gl_stream_buffer_t *buf)
+{
+	if (buf->handle != 0)
+		GL_CHECK(glDeleteBuffers, 1, &buf->handle);
+	buf->handle = 0;
+}
+
+/* Leaves the buffer bound & returns the offset of the data within it */
+static
+size_t gl_stream_buffer_write(gl_stream_buffer_t *buf, const void *data, size_t size)
+{
+	size_t offset;
+
+	GL_CHECK(glBindBuffer, buf->target, buf->handle);
+
+	if (size == 0)
+		return 0;
+
+	if (buf->offset + size > buf->size) {
+		if (size * SDL_GL_STREAM_FRAMES > buf->size)
+			buf->size = size * SDL_GL_STREAM_FRAMES;
+		GL_CHECK(glBufferData, buf->target, buf->size, NULL, GL_STREAM_DRAW);
+		buf->offset = 0;
+	}
+
+	offset = buf->offset;
+#if defined(__EMSCRIPTEN__) || defined(SDL_GL_ES_2)
+	GL_CHECK(glBufferSubData, buf->target, offset, size, data);
+#else
+	{
+		void *dst = glMapBufferRange(buf->target, offset, size,
+		                             GL_MAP_WRITE_BIT
+		                             | GL_MAP_INVALIDATE_RANGE_BIT
+		                             | GL_MAP_UNSYNCHRONIZED_BIT);
+		GL_ERR_CHECK("glMapBufferRange");
+		if (dst) {
+			memcpy(dst, data, size);
+			GL_CHECK(glUnmapBuffer, buf->target);
+		} else {
+			GL_CHECK(glBufferSubData, buf->target, offset, size, data);
+		}
+	}
+#endif
+	buf->offset = (offset + size + SDL_GL_STREAM_ALIGN - 1) & ~(size_t)(SDL_GL_STREAM_ALIGN - 1);
+	return offset;
 }
 
-typedef enum gui_vbo_type
+typedef enum gui_vert_attrib
 {
-	VBO_VERT,
-	VBO_COLOR,
-	VBO_TEX,
-	VBO_COUNT
-} gui_vbo_type_e;
+	VERT_ATTRIB_POS,
+	VERT_ATTRIB_COLOR,
+	VERT_ATTRIB_TEX,
+	VERT_ATTRIB_COUNT
+} gui_vert_attrib_e;
+
+/* Image cache
+ * Images requested through window_get_img are decoded by worker threads.
+ * Decoded pixels are uploaded on the main thread a few rows at a time, so
+ * a burst of new images is spread over several frames.  A transparent
+ * placeholder is returned until the upload completes. */
+
+#ifndef SDL_GL_IMG_WORKERS
+#ifdef __EMSCRIPTEN__
+#define SDL_GL_IMG_WORKERS 0
+#else
+#define SDL_GL_IMG_WORKERS 2
+#endif
+#endif
+
+#ifndef SDL_GL_IMG_UPLOAD_BYTES_PER_FRAME
+#define SDL_GL_IMG_UPLOAD_BYTES_PER_FRAME (4 * 1024 * 1024)
+#endif
+
+#ifndef SDL_GL_IMG_BUCKETS
+#define SDL_GL_IMG_BUCKETS 256
+#endif
+
+typedef enum cached_img_state
+{
+	CACHED_IMG_DECODING,
+	CACHED_IMG_UPLOADING,
+	CACHED_IMG_READY,
+	CACHED_IMG_FAILED,
+} cached_img_state_e;
 
 typedef struct cached_img
 {
 	gui_img_t img;
 	u32 id;
+	cached_img_state_e state;
+	u8 *pixels;
+	u32 rows_uploaded;
+	struct cached_img *next;
 } cached_img_t;
 
+typedef struct img_job
+{
+	cached_img_t *cached_img;
+	str_t path;
+	u8 *pixels;
+	s32 w, h;
+} img_job_t;
+
+typedef struct img_loader
+{
+	SDL_mutex *mutex;
+	SDL_cond *cond;
+	SDL_Thread *workers[SDL_GL_IMG_WORKERS + 1];
+	u32 num_workers;
+	b32 quit;
+	/* guarded by mutex */
+	array(img_job_t) jobs;
+	array(img_job_t) decoded;
+	/* main thread only */
+	array(img_job_t) received;
+	array(cached_img_t*) uploads;
+	u32 num_in_flight;
+} img_loader_t;
+
+static
+void img_loader__decode(img_job_t *job)
+{
+	job->pixels = stbi_load(job->path, &job->w, &job->h, NULL, 4);
+	if (!job->pixels)
+		log_error("img_load(%s) error: %s", job->path, stbi_failure_reason());
+}
+
+static
+int img_loader__worker(void *udata)
+{
+	img_loader_t *loader = udata;
+	img_job_t job;
+
+	vlt_init(VLT_THREAD_OTHER);
+
+	SDL_LockMutex(loader->mutex);
+	for (;;) {
+		while (!loader->quit && array_empty(loader->jobs))
+			SDL_CondWait(loader->cond, loader->mutex);
+		if (loader->quit)
+			break;
+		job = loader->jobs[0];
+		array_remove(loader->jobs, 0);
+		SDL_UnlockMutex(loader->mutex);
+
+		img_loader__decode(&job);
+
+		SDL_LockMutex(loader->mutex);
+		array_append(loader->decoded, job);
+	}
+	SDL_UnlockMutex(loader->mutex);
+
+	vlt_destroy(VLT_THREAD_OTHER);
+	return 0;
+}
+
+static
+void img_loader_init(img_loader_t *loader)
+{
+	/* NOTE(rgriege): this is global state in stb_image, so set it once up front
+	 * rather than racing the workers */
+	stbi_set_flip_vertically_on_load(true);
+
+	loader->quit = false;
+	loader->jobs = array_create();
+	loader->decoded = array_create();
+	loader->received = array_create();
+	loader->uploads = array_create();
+	loader->num_in_flight = 0;
+	loader->num_workers = 0;
+	loader->mutex = SDL_CreateMutex();
+	loader->cond = SDL_CreateCond();
+	if (!loader->mutex || !loader->cond) {
+		log_error("img loader: failed to create sync objects: %s", SDL_GetError());
+		return;
+	}
+	for (u32 i = 0; i < SDL_GL_IMG_WORKERS; ++i) {
+		SDL_Thread *thread = SDL_CreateThread(img_loader__worker, "img_loader", loader);
+		if (!thread) {
+			log_warn("img loader: failed to create worker: %s", SDL_GetError());
+			break;
+		}
+		loader->workers[loader->num_workers++] = thread;
+	}
+}
+
+static
+void img_loader_destroy(img_loader_t *loader)
+{
+	if (loader->mutex) {
+		SDL_LockMutex(loader->mutex);
+		loader->quit = true;
+		SDL_CondBroadcast(loader->cond);
+		SDL_UnlockMutex(loader->mutex);
+	}
+	for (u32 i = 0; i < loader->num_workers; ++i)
+		SDL_WaitThread(loader->workers[i], NULL);
+
+	array_foreach(loader->jobs, img_job_t, job)
+		str_destroy(&job->path);
+	array_foreach(loader->decoded, img_job_t, job) {
+		str_destroy(&job->path);
+		if (job->pixels)
+			stbi_image_free(job->pixels);
+	}
+	array_destroy(loader->jobs);
+	array_destroy(loader->decoded);
+	array_destroy(loader->received);
+	array_destroy(loader->uploads);
+
+	if (loader->cond)
+		SDL_DestroyCond(loader->cond);
+	if (loader->mutex)
+		SDL_DestroyMutex(loader->mutex);
+}
+
+static
+void img_loader_request(img_loader_t *loader, cached_img_t *cached_img, const char *path)
+{
+	img_job_t job = {
+		.cached_img = cached_img,
+		.path = str_dup(path, g_allocator),
+	};
+
+	++loader->num_in_flight;
+
+	if (loader->num_workers == 0) {
+		array_append(loader->jobs, job);
+		return;
+	}
+
+	SDL_LockMutex(loader->mutex);
+	array_append(loader->jobs, job);
+	SDL_CondSignal(loader->cond);
+	SDL_UnlockMutex(loader->mutex);
+}
+
+static
+void img_loader__receive(img_loader_t *loader, img_job_t *job)
+{
+	cached_img_t *cached_img = job->cached_img;
+
+	str_destroy(&job->path);
+	if (!job->pixels) {
+		cached_img->state = CACHED_IMG_FAILED;
+		--loader->num_in_flight;
+		return;
+	}
+
+	texture_init(&cached_img->img, job->w, job->h, GL_RGBA, NULL);
+	cached_img->pixels = job->pixels;
+	cached_img->rows_uploaded = 0;
+	cached_img->state = CACHED_IMG_UPLOADING;
+	array_append(loader->uploads, cached_img);
+}
+
+/* Returns true while any image is still being decoded or uploaded */
+static
+b32 img_loader_update(img_loader_t *loader)
+{
+	s64 budget = SDL_GL_IMG_UPLOAD_BYTES_PER_FRAME;
+	img_job_t job;
+
+	if (loader->num_in_flight == 0)
+		return false;
+
+	if (loader->num_workers == 0) {
+		/* no workers, so decode a single image per frame */
+		if (array_sz(loader->jobs) > 0) {
+			job = loader->jobs[0];
+			array_remove(loader->jobs, 0);
+			img_loader__decode(&job);
+			img_loader__receive(loader, &job);
+		}
+	} else {
+		array(img_job_t) decoded;
+		SDL_LockMutex(loader->mutex);
+		decoded = loader->decoded;
+		loader->decoded = loader->received;
+		loader->received = decoded;
+		SDL_UnlockMutex(loader->mutex);
+		array_foreach(loader->received, img_job_t, received)
+			img_loader__receive(loader, received);
+		array_clear(loader->received);
+	}
+
+	while (array_sz(loader->uploads) > 0 && budget > 0) {
+		cached_img_t *cached_img = loader->uploads[0];
+		gui_img_t *img = &cached_img->img;
+		const s64 row_sz = img->width * 4;
+		const u32 rows_left = img->height - cached_img->rows_uploaded;
+		const u32 rows = (u32)clamp(1, budget / row_sz, (s64)rows_left);
+
+		texture_bind(img);
+		GL_CHECK(glTexSubImage2D, GL_TEXTURE_2D, 0, 0, cached_img->rows_uploaded,
+		         img->width, rows, GL_RGBA, GL_UNSIGNED_BYTE,
+		         cached_img->pixels + cached_img->rows_uploaded * row_sz);
+		texture_unbind();
+		cached_img->rows_uploaded += rows;
+		budget -= rows * row_sz;
+
+		if (cached_img->rows_uploaded == img->height) {
+			stbi_image_free(cached_img->pixels);
+			cached_img->pixels = NULL;
+			cached_img->state = CACHED_IMG_READY;
+			array_remove(loader->uploads, 0);
+			--loader->num_in_flight;
+		}
+	}
+
+	return true;
+}
+
+#ifndef SDL_GL_FONT_BUCKETS
+#define SDL_GL_FONT_BUCKETS 64
+#endif
+
 typedef struct window
 {
 	SDL_Window *window;
@@ -1061,10 +1395,11 @@ typedef struct window
 	SDL_Window *parent_window;
 	SDL_GLContext parent_gl_context;
 	/* rendering */
-	u32 vao, vbo[VBO_COUNT];
+	u32 vao;
+	gl_stream_buffer_t vbo, ibo;
 	shader_prog_t shader;
 #ifdef SDL_GL_ES_2
-	s32 shader_attrib_loc[VBO_COUNT];
+	s32 shader_attrib_loc[VERT_ATTRIB_COUNT];
 #endif
 	gui_texture_t texture_white;
 	gui_texture_t texture_white_dotted;
@@ -1075,11 +1410,14 @@ typedef struct window
 
 	/* style */
 	SDL_Cursor *cursors[GUI_CURSOR_COUNT];
-	array(font_t) fonts;
+	font_atlas_t *font_atlas;
+	font_t *fonts[SDL_GL_FONT_BUCKETS];
 	font_t *last_font;
 	u32 last_font_path_hash;
 	s32 last_font_size;
-	array(cached_img_t) imgs;
+	cached_img_t *imgs[SDL_GL_IMG_BUCKETS];
+	img_loader_t img_loader;
+	gui_img_t img_placeholder;
 
 	gui_t *gui;
 } window_t;
@@ -1231,27 +1569,36 @@ void window_set_title(window_t *window, const char *title)
 	SDL_SetWindowTitle(window->window, title);
 }
 
+static
+u32 window__font_bucket(u32 path_hash, s32 size)
+{
+	return (path_hash ^ ((u32)size * 2654435761u)) % SDL_GL_FONT_BUCKETS;
+}
+
 static
 font_t *window__find_font(window_t *window, u32 path_hash, s32 size)
 {
-	array_iterate(window->fonts, i, n)
-		if (window->fonts[i].path_hash == path_hash && window->fonts[i].size == size)
-			return &window->fonts[i];
+	for (font_t *f = window->fonts[window__font_bucket(path_hash, size)]; f; f = f->next)
+		if (f->path_hash == path_hash && f->size == size)
+			return f;
 	return NULL;
 }
 
+/* Only used after a font fails to load, so scanning every bucket is fine */
 static
 font_t *window__find_smaller_font(window_t *window, u32 path_hash, s32 size)
 {
 	font_t *nearest = NULL;
 	s32 max_size = 0;
-	array_iterate(window->fonts, i, n) {
-		if (   window->fonts[i].path_hash == path_hash
-		    && window->fonts[i].char_info
-		    && window->fonts[i].size < size
-		    && window->fonts[i].size > max_size) {
-			nearest = &window->fonts[i];
-			max_size = window->fonts[i].size;
+	for (u32 i = 0; i < SDL_GL_FONT_BUCKETS; ++i) {
+		for (font_t *f = window->fonts[i]; f; f = f->next) {
+			if (   f->path_hash == path_hash
+			    && f->glyphs
+			    && f->size < size
+			    && f->size > max_size) {
+				nearest = f;
+				max_size = f->size;
+			}
 		}
 	}
 	return nearest;
@@ -1262,7 +1609,7 @@ void *window__get_font(void *handle, const char *path, s32 size)
 {
 	const u32 path_hash = hash_compute(path);
 	window_t *window = handle;
-	font_t *font;
+	font_t *font, **bucket;
 
 	if (path[0] == 0)
 		return window->last_font;
@@ -1274,18 +1621,20 @@ void *window__get_font(void *handle, const char *path, s32 size)
 	window->last_font_size = size;
 
 	if ((font = window__find_font(window, path_hash, size))) {
-		window->last_font = font->char_info ? font : window__find_smaller_font(window, path_hash, size);
+		window->last_font = font->glyphs ? font : window__find_smaller_font(window, path_hash, size);
 		return window->last_font;
 	}
 
-	window->last_font = NULL;
-	font = array_append_null(window->fonts);
-	if (font_load(font, path, size)) {
+	/* fonts are allocated individually, since the gui holds on to their addresses */
+	font = acalloc(1, sizeof(font_t), g_allocator);
+	bucket = &window->fonts[window__font_bucket(path_hash, size)];
+	font->next = *bucket;
+	*bucket = font;
+	if (font_load(font, path, size, window->font_atlas)) {
 		window->last_font = font;
 		return window->last_font;
 	} else {
 		/* keep empty entries around so we don't try to load them again */
-		memclr(*font);
 		font->filename = path;
 		font->path_hash = path_hash;
 		font->size = size;
@@ -1305,23 +1654,27 @@ b32 window__get_font_metrics(void *handle, gui_font_metrics_t *metrics)
 static
 b32 window__get_char_quad(void *handle, s32 codepoint, r32 x, r32 y, gui_char_quad_t *quad)
 {
-	const font_t *font = handle;
+	font_t *font = handle;
 	const r32 x0 = x;
 #ifndef NDEBUG
 	const r32 y0 = y;
 #endif
-	const int index = font__get_index_for_codepoint(font, codepoint);
+	const int index = stbtt_FindGlyphIndex(font->info, codepoint);
+	const font_glyph_t *glyph;
 	stbtt_aligned_quad q;
 
 	if (index == 0)
 		return false;
 
-	stbtt_GetPackedQuad(font->char_info, font->texture.width, font->texture.height,
-	                    index, &x, &y, &q, 0);
+	if (!(glyph = font__get_glyph(font, index)))
+		return false;
+
+	stbtt_GetPackedQuad(&glyph->packed, SDL_GL_FONT_ATLAS_DIM, SDL_GL_FONT_ATLAS_DIM,
+	                    0, &x, &y, &q, 0);
 	assert(y0 == y);
 
 	/* NOTE(rgriege): stbtt assumes y=0 at top, but for violet y=0 is at bottom */
-	quad->texture = font->texture;
+	quad->texture = font->atlas->pages[glyph->page]->texture;
 	quad->x0 = q.x0;
 	quad->y0 = y + (y - q.y1);
 	quad->s0 = q.s0;
@@ -1337,7 +1690,7 @@ b32 window__get_char_quad(void *handle, s32 codepoint, r32 x, r32 y, gui_char_qu
 static
 cached_img_t *window__find_img(window_t *window, u32 id)
 {
-	array_foreach(window->imgs, cached_img_t, ci)
+	for (cached_img_t *ci = window->imgs[id % SDL_GL_IMG_BUCKETS]; ci; ci = ci->next)
 		if (ci->id == id)
 			return ci;
 	return NULL;
@@ -1352,16 +1705,26 @@ const gui_img_t *window_get_img(window_t *window, const char *fname)
 {
 	const u32 id = hash_compute(fname);
 	cached_img_t *cached_img = window__find_img(window, id);
-	if (cached_img)
-		return &cached_img->img;
+	cached_img_t **bucket;
+
+	if (!cached_img) {
+		cached_img = acalloc(1, sizeof(cached_img_t), g_allocator);
+		cached_img->id = id;
+		cached_img->state = CACHED_IMG_DECODING;
+		bucket = &window->imgs[id % SDL_GL_IMG_BUCKETS];
+		cached_img->next = *bucket;
+		*bucket = cached_img;
+		img_loader_request(&window->img_loader, cached_img, fname);
+	}
 
-	cached_img = array_append_null(window->imgs);
-	cached_img->id = id;
-	if (img_load(&cached_img->img, fname))
+	switch (cached_img->state) {
+	case CACHED_IMG_READY:
 		return &cached_img->img;
-
-	array_pop(window->imgs);
-	return NULL;
+	case CACHED_IMG_FAILED:
+		return NULL;
+	default:
+		return &window->img_placeholder;
+	}
 }
 
 static
@@ -1718,7 +2081,8 @@ window_t *window_create_ex(s32 x, s32 y, s32 w, s32 h, const char *title,
 	GL_CHECK(glEnable, GL_SCISSOR_TEST);
 
 	GL_CHECK(glGenVertexArrays, 1, &window->vao);
-	GL_CHECK(glGenBuffers, VBO_COUNT, window->vbo);
+	gl_stream_buffer_init(&window->vbo, GL_ARRAY_BUFFER);
+	gl_stream_buffer_init(&window->ibo, GL_ELEMENT_ARRAY_BUFFER);
 
 	static const color_t texture_white_data[1] = { gi_white };
 	texture_init(&window->texture_white, 1, 1, GL_RGBA, texture_white_data);
@@ -1735,9 +2099,9 @@ window_t *window_create_ex(s32 x, s32 y, s32 w, s32 h, const char *title,
 		goto err_white;
 
 #ifdef SDL_GL_ES_2
-	window->shader_attrib_loc[VBO_VERT]  = shader_program_attrib(&window->shader, "position");
-	window->shader_attrib_loc[VBO_COLOR] = shader_program_attrib(&window->shader, "color");
-	window->shader_attrib_loc[VBO_TEX]   = shader_program_attrib(&window->shader, "tex_coord");
+	window->shader_attrib_loc[VERT_ATTRIB_POS]   = shader_program_attrib(&window->shader, "position");
+	window->shader_attrib_loc[VERT_ATTRIB_COLOR] = shader_program_attrib(&window->shader, "color");
+	window->shader_attrib_loc[VERT_ATTRIB_TEX]   = shader_program_attrib(&window->shader, "tex_coord");
 #endif
 
 	window->cursors[GUI_CURSOR_DEFAULT] = SDL_CreateSystemCursor(SDL_SYSTEM_CURSOR_ARROW);
@@ -1752,10 +2116,16 @@ window_t *window_create_ex(s32 x, s32 y, s32 w, s32 h, const char *title,
 	for (u32 i = 0; i < GUI_CURSOR_COUNT; ++i)
 		if (!window->cursors[i])
 			goto err_cursor;
-	window->fonts = array_create();
+	window->font_atlas = font_atlas_create();
+	memset(window->fonts, 0, sizeof(window->fonts));
 	window->last_font = NULL;
 	window->last_font_size = 0;
-	window->imgs = array_create();
+	memset(window->imgs, 0, sizeof(window->imgs));
+	img_loader_init(&window->img_loader);
+	{
+		static const u8 img_placeholder_data[4] = { 0, 0, 0, 0 };
+		texture_init(&window->img_placeholder, 1, 1, GL_RGBA, img_placeholder_data);
+	}
 
 	{
 		SDL_Event evt;
@@ -1794,7 +2164,8 @@ err_cursor:
 err_white:
 	texture_destroy(&window->texture_white);
 	texture_destroy(&window->texture_white_dotted);
-	GL_CHECK(glDeleteBuffers, 3, window->vbo);
+	gl_stream_buffer_destroy(&window->vbo);
+	gl_stream_buffer_destroy(&window->ibo);
 	GL_CHECK(glDeleteVertexArrays, 1, &window->vao);
 err_ver:
 err_glew:
@@ -1816,16 +2187,31 @@ void window_destroy(window_t *window)
 {
 	for (u32 i = 0; i < GUI_CURSOR_COUNT; ++i)
 		SDL_FreeCursor(window->cursors[i]);
-	array_foreach(window->fonts, font_t, f)
-		font_destroy(f);
-	array_destroy(window->fonts);
-	array_foreach(window->imgs, cached_img_t, ci)
-		img_destroy(&ci->img);
-	array_destroy(window->imgs);
+	for (u32 i = 0; i < SDL_GL_FONT_BUCKETS; ++i) {
+		for (font_t *f = window->fonts[i], *next; f; f = next) {
+			next = f->next;
+			font_destroy(f);
+			afree(f, g_allocator);
+		}
+	}
+	font_atlas_destroy(window->font_atlas);
+	img_loader_destroy(&window->img_loader);
+	for (u32 i = 0; i < SDL_GL_IMG_BUCKETS; ++i) {
+		for (cached_img_t *ci = window->imgs[i], *next; ci; ci = next) {
+			next = ci->next;
+			if (ci->state == CACHED_IMG_UPLOADING || ci->state == CACHED_IMG_READY)
+				img_destroy(&ci->img);
+			if (ci->pixels)
+				stbi_image_free(ci->pixels);
+			afree(ci, g_allocator);
+		}
+	}
+	img_destroy(&window->img_placeholder);
 	shader_program_destroy(&window->shader);
 	texture_destroy(&window->texture_white);
 	texture_destroy(&window->texture_white_dotted);
-	GL_CHECK(glDeleteBuffers, 3, window->vbo);
+	gl_stream_buffer_destroy(&window->vbo);
+	gl_stream_buffer_destroy(&window->ibo);
 	GL_CHECK(glDeleteVertexArrays, 1, &window->vao);
 	SDL_GL_DeleteContext(window->gl_context);
 	SDL_DestroyWindow(window->window);
@@ -1961,6 +2347,10 @@ b32 window_begin_frame(window_t *window)
 	gui_event_set_mouse_pos(gui, mouse_pos.x, mouse_pos.y);
 	gui_event_set_mouse_btn(gui, mouse_btn);
 
+	/* keep frames coming while images stream in, so they appear once ready */
+	if (img_loader_update(&window->img_loader))
+		gui_event_add_update(gui);
+
 	gui_events_end(gui);
 
 	GL_CHECK(glViewport, 0, 0, drawable_dim.x, drawable_dim.y);
@@ -1992,18 +2382,24 @@ void window_end_frame(window_t *window)
 #ifdef SDL_GL_ES_2
 	const s32 *loc = window->shader_attrib_loc;
 #else
-	const s32 loc[VBO_COUNT] = { VBO_VERT, VBO_COLOR, VBO_TEX };
+	const s32 loc[VERT_ATTRIB_COUNT] = { VERT_ATTRIB_POS, VERT_ATTRIB_COLOR, VERT_ATTRIB_TEX };
 #endif
+	const GLsizei stride = sizeof(gui_vertex_t);
 	gui_t *gui = window->gui;
 	gui_render_output_t output;
 	GLuint current_texture = 0;
+	size_t vert_offset, index_offset = 0;
+	timepoint_t submit_start;
 	v2i dim;
 
-	gui_get_render_output(gui, &output);
-
 	u32 current_blend = GUI_BLEND_NRM;
 
+	/* gui_end_frame can still emit geometry (e.g. splits), which may grow and
+	 * reallocate the render buffers, so grab the output afterwards */
 	gui_end_frame(gui);
+	submit_start = timepoint_create();
+
+	gui_get_render_output(gui, &output);
 
 	gui_dim(gui, &dim.x, &dim.y);
 
@@ -2014,23 +2410,21 @@ void window_end_frame(window_t *window)
 	GL_CHECK(glDisable, GL_DEPTH_TEST);
 	GL_CHECK(glBindVertexArray, window->vao);
 
-	GL_CHECK(glBindBuffer, GL_ARRAY_BUFFER, window->vbo[VBO_VERT]);
-	GL_CHECK(glBufferData, GL_ARRAY_BUFFER, output.num_verts * sizeof(v2f),
-	         output.verts.pos, GL_STREAM_DRAW);
-	GL_CHECK(glVertexAttribPointer, loc[VBO_VERT], 2, GL_FLOAT, GL_FALSE, 0, 0);
-	GL_CHECK(glEnableVertexAttribArray, loc[VBO_VERT]);
-
-	GL_CHECK(glBindBuffer, GL_ARRAY_BUFFER, window->vbo[VBO_COLOR]);
-	GL_CHECK(glBufferData, GL_ARRAY_BUFFER, output.num_verts * sizeof(color_t),
-	         output.verts.color, GL_STREAM_DRAW);
-	GL_CHECK(glVertexAttribPointer, loc[VBO_COLOR], 4, GL_UNSIGNED_BYTE, GL_TRUE, 0, 0);
-	GL_CHECK(glEnableVertexAttribArray, loc[VBO_COLOR]);
-
-	GL_CHECK(glBindBuffer, GL_ARRAY_BUFFER, window->vbo[VBO_TEX]);
-	GL_CHECK(glBufferData, GL_ARRAY_BUFFER, output.num_verts * sizeof(v2f),
-	         output.verts.tex_coord, GL_STREAM_DRAW);
-	GL_CHECK(glVertexAttribPointer, loc[VBO_TEX], 2, GL_FLOAT, GL_FALSE, 0, 0);
-	GL_CHECK(glEnableVertexAttribArray, loc[VBO_TEX]);
+	vert_offset = gl_stream_buffer_write(&window->vbo, output.verts,
+	                                     output.num_verts * sizeof(gui_vertex_t));
+	GL_CHECK(glVertexAttribPointer, loc[VERT_ATTRIB_POS], 2, GL_FLOAT, GL_FALSE, stride,
+	         (const void *)(vert_offset + offsetof(gui_vertex_t, pos)));
+	GL_CHECK(glEnableVertexAttribArray, loc[VERT_ATTRIB_POS]);
+	GL_CHECK(glVertexAttribPointer, loc[VERT_ATTRIB_COLOR], 4, GL_UNSIGNED_BYTE, GL_TRUE, stride,
+	         (const void *)(vert_offset + offsetof(gui_vertex_t, color)));
+	GL_CHECK(glEnableVertexAttribArray, loc[VERT_ATTRIB_COLOR]);
+	GL_CHECK(glVertexAttribPointer, loc[VERT_ATTRIB_TEX], 2, GL_FLOAT, GL_FALSE, stride,
+	         (const void *)(vert_offset + offsetof(gui_vertex_t, tex_coord)));
+	GL_CHECK(glEnableVertexAttribArray, loc[VERT_ATTRIB_TEX]);
+
+	if (output.indices)
+		index_offset = gl_stream_buffer_write(&window->ibo, output.indices,
+		                                      output.num_indices * sizeof(gui_index_t));
 
 	GL_CHECK(glUseProgram, window->shader.handle);
 	GL_CHECK(glUniform2f, glGetUniformLocation(window->shader.handle, "window_halfdim"),
@@ -2069,14 +2463,21 @@ void window_end_frame(window_t *window)
 				current_blend = draw_call->blend;
 			}
 
-			GL_CHECK(glDrawArrays, g_draw_call_types[draw_call->type],
-			         draw_call->idx, draw_call->cnt);
+			if (output.indices)
+				GL_CHECK(glDrawElements, g_draw_call_types[draw_call->type],
+				         draw_call->cnt, GL_UNSIGNED_INT,
+				         (const void *)(index_offset + draw_call->idx * sizeof(gui_index_t)));
+			else
+				GL_CHECK(glDrawArrays, g_draw_call_types[draw_call->type],
+				         draw_call->idx, draw_call->cnt);
 		}
 	}
 
 	SDL_SetCursor(window->cursors[gui_cursor(gui)]);
 
 	GL_CHECK(glFlush);
+	/* excludes the swap, which may wait for vsync */
+	gui_frame_metrics_set_submit_micro(gui, timepoint_diff_micro(submit_start, timepoint_create()));
 	SDL_GL_SwapWindow(window->window);
 
 	if (gui_has_clipboard_text(gui)) {
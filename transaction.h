@@ -8,10 +8,29 @@ typedef struct transaction_logger {
 	void *userp;
 } transaction_logger_t;
 
+/* Once event_history holds more than max_events events, the oldest events are
+ * written to a file under imcachedir() & freed, then read back on deep undo.
+ * Events with dynamic instances are written with their save/load contract hooks,
+ * whose userp comes from serializer_create (or is the FILE* itself if NULL).
+ * Events with a create or destroy hook but without both of those stay in memory. */
+typedef struct transaction_history_budget {
+	u32 max_events; /* 0 is unlimited */
+	void *(*serializer_create)(FILE *fp, void *userp);
+	void  (*serializer_destroy)(void *serializer, void *userp);
+	void *userp;
+} transaction_history_budget_t;
+
+typedef struct transaction_spill_chunk {
+	long offset;
+	long size;
+	u32 num_events;
+	b32 undoable;
+} transaction_spill_chunk_t;
+
 typedef struct transaction_system {
 	allocator_t *alc;
 	array(store_t *) stores;
-	/* append-only stack of event history */
+	/* append-only stack of event history, minus any spilled chunks */
 	array(event_t *) event_history;
 	/* secondary events awaiting confirmation by a primary event */
 	array(event_t *) temp_secondary_events;
@@ -19,12 +38,22 @@ typedef struct transaction_system {
 	b32 undoing;
 	event_t *active_parent;
 	transaction_logger_t *logger; /* NULLable, unowned */
+	transaction_history_budget_t budget;
+	/* stack of spilled chunks, oldest first, all preceding event_history */
+	array(transaction_spill_chunk_t) spilled;
+	FILE *spill_fp;
+	str_t spill_path;
+	/* plain events are spawned here & only copied to alc if they are kept */
+	struct transaction_arena *arena;
 } transaction_system_t;
 
+/* events & stores are allocated individually from alc, e.g. a pool allocator */
 transaction_system_t transaction_system_create(transaction_logger_t *logger, allocator_t *alc);
 void transaction_system_reset(transaction_system_t *sys);
 void transaction_system_destroy(transaction_system_t *sys);
 void transaction_system_set_active(transaction_system_t *sys);
+void transaction_system_set_history_budget(transaction_system_t *sys,
+                                           transaction_history_budget_t budget);
 void transaction_spawn_store(const store_metadata_t *meta, u32 kind);
 void *transaction_spawn_event(const event_metadata_t *meta, const char *nav_description, u32 kind);
 void *transaction_spawn_empty_event(const event_metadata_t *meta, const char *nav_description, u32 kind);
@@ -32,6 +61,7 @@ void transaction_get_undoables(array(event_t *) *undoables);
 void transaction_get_redoables(array(event_t *) *redoables);
 b32  transaction_system_can_undo(void);
 b32  transaction_system_can_redo(void);
+/* Takes ownership of the events in history, even on failure */
 b32  transaction_system_restore(array(event_t *) history);
 /* Returns a nonzero event kind for executed, non-secondary events */
 u32 transaction__flush(event_t *event);
@@ -62,6 +92,66 @@ extern void event_undo_redo__create(void *instance, allocator_t *alc);
 
 transaction_system_t *g_active_transaction_system = NULL;
 
+/* Multi-frame interactions spawn an event every frame that is merged into the
+ * last one & destroyed, so events without dynamic data are bumped from pages
+ * that are reset once no spawned events are pending. */
+typedef struct transaction_arena {
+	pgb_heap_t heap;
+	pgb_t pgb;
+	pgb_watermark_t empty;
+	allocator_t alc;
+	u32 pending;
+} transaction_arena_t;
+
+static
+transaction_arena_t *transaction__arena_create(allocator_t *alc)
+{
+	transaction_arena_t *arena = amalloc(sizeof(transaction_arena_t), alc);
+	pgb_heap_init(&arena->heap);
+	pgb_init(&arena->pgb, &arena->heap);
+	arena->empty = pgb_save(&arena->pgb);
+	arena->alc = allocator_create(temp, &arena->pgb);
+	arena->pending = 0;
+	return arena;
+}
+
+static
+void transaction__arena_destroy(transaction_arena_t *arena, allocator_t *alc)
+{
+	pgb_restore(arena->empty);
+	pgb_destroy(&arena->pgb);
+	pgb_heap_destroy(&arena->heap);
+	afree(arena, alc);
+}
+
+static
+void transaction__arena_reset(transaction_arena_t *arena)
+{
+	arena->pending = 0;
+	pgb_restore(arena->empty);
+	arena->empty = pgb_save(&arena->pgb);
+}
+
+/* Kept events are copied out of the arena; a non-arena event never has arena
+ * children, since children are promoted when appended to one. */
+static
+event_t *transaction__promote_event(transaction_system_t *sys, event_t *event)
+{
+	const size_t size = sizeof(event_t) + event->meta->size;
+	event_t *copy;
+
+	if (!event->from_arena)
+		return event;
+
+	copy = amalloc(size, sys->alc);
+	memcpy(copy, event, size);
+	copy->from_arena = false;
+	array_init_inline(copy->children, copy->children_storage, sys->alc);
+	array_foreach(event->children, event_t *, child_ptr)
+		array_append(copy->children, transaction__promote_event(sys, *child_ptr));
+	return copy;
+}
+
 static
 u32 transaction__handle_ordinary_event(transaction_system_t *sys, event_t *event);
 
@@ -93,9 +183,27 @@ transaction_system_t transaction_system_create(transaction_logger_t *logger, all
 		.undoing = false,
 		.active_parent = NULL,
 		.logger = logger,
+		.budget = { .max_events = 0 },
+		.spilled = array_create_ex(alc),
+		.spill_fp = NULL,
+		.spill_path = str_create(alc),
+		.arena = transaction__arena_create(alc),
 	};
 }
 
+static
+void transaction__close_spill(transaction_system_t *sys)
+{
+	if (sys->spill_fp) {
+		fclose(sys->spill_fp);
+		sys->spill_fp = NULL;
+		if (remove(sys->spill_path) != 0)
+			log_warn("failed to remove undo history file '%s'", sys->spill_path);
+	}
+	array_clear(sys->spilled);
+	str_clear(&sys->spill_path);
+}
+
 /* store data is NOT reset */
 void transaction_system_reset(transaction_system_t *sys)
 {
@@ -107,6 +215,9 @@ void transaction_system_reset(transaction_system_t *sys)
 		event_destroy(*event_temp, sys->alc);
 	array_clear(sys->temp_secondary_events);
 
+	transaction__close_spill(sys);
+	transaction__arena_reset(sys->arena);
+
 	str_clear(&sys->last_event_desc);
 }
 
@@ -124,6 +235,12 @@ void transaction_system_destroy(transaction_system_t *sys)
 		event_destroy(*event_temp, sys->alc);
 	array_destroy(sys->temp_secondary_events);
 
+	transaction__close_spill(sys);
+	array_destroy(sys->spilled);
+	str_destroy(&sys->spill_path);
+
+	transaction__arena_destroy(sys->arena, sys->alc);
+
 	str_destroy(&sys->last_event_desc);
 }
 
@@ -132,17 +249,31 @@ void transaction_system_set_active(transaction_system_t *sys)
 	g_active_transaction_system = sys;
 }
 
+void transaction_system_set_history_budget(transaction_system_t *sys,
+                                           transaction_history_budget_t budget)
+{
+	sys->budget = budget;
+}
+
+static
+b32 transaction__page_in(transaction_system_t *sys);
+
 static
 event_t *transaction__last_doable_event(transaction_system_t *sys, b32 undoing)
 {
 	event_t *result = NULL;
 	array(event_t *) doables;
-	array_init_ex(doables, 4, g_temp_allocator);
+	array_storage(event_t *, 16) doables_storage;
+	array_init_inline(doables, doables_storage, g_temp_allocator);
 
-	if (undoing)
+	if (undoing) {
 		transaction_get_undoables(&doables);
-	else
+		/* spilled chunks are never undone, so only undo can reach them */
+		while (array_empty(doables) && transaction__page_in(sys))
+			transaction_get_undoables(&doables);
+	} else {
 		transaction_get_redoables(&doables);
+	}
 
 	if (!array_empty(doables))
 		result = doables[0];
@@ -266,23 +397,50 @@ b32 transaction_system_restore(array(event_t *) history)
 	assert(array_empty(sys->event_history));
 	array_iterate(history, i, n) {
 		if (!transaction__redo_event(sys, history[i])) {
-			array_clear(sys->event_history);
 			log_error("failed to restore event %s", history[i]->meta->label);
-			for (; i-- > 0; )
-				log_error("after restoring event %s", history[i]->meta->label);
+			for (array_size_t j = i; j-- > 0; )
+				log_error("after restoring event %s", history[j]->meta->label);
+			/* restored events were promoted, the rest are still pending in the arena */
+			sys->active_parent = NULL;
+			array_foreach(sys->event_history, event_t *, event_ptr)
+				event_destroy(*event_ptr, sys->alc);
+			array_clear(sys->event_history);
+			for (array_size_t j = i; j < n; ++j) {
+				if (history[j]->from_arena)
+					sys->arena->pending--;
+				event_destroy(history[j], sys->alc);
+			}
+			array_clear(history);
+			if (sys->arena->pending == 0)
+				transaction__arena_reset(sys->arena);
 			return false;
 		}
-		array_append(sys->event_history, history[i]);
+		array_append(sys->event_history, transaction__promote_event(sys, history[i]));
+		if (history[i]->from_arena)
+			sys->arena->pending--;
 	}
 	array_clear(history);
+	if (sys->arena->pending == 0)
+		transaction__arena_reset(sys->arena);
 	return true;
 }
 
 b32 transaction_system_can_undo(void)
 {
 	transaction_system_t *sys = g_active_transaction_system;
-	event_t *event = transaction__last_doable_event(sys, true);
-	return event != NULL;
+	array(event_t *) undoables;
+	array_storage(event_t *, 16) undoables_storage;
+	b32 result;
+
+	array_init_inline(undoables, undoables_storage, g_temp_allocator);
+	transaction_get_undoables(&undoables);
+	result = !array_empty(undoables);
+	array_destroy(undoables);
+
+	/* avoid paging events back in just to answer */
+	array_foreach(sys->spilled, transaction_spill_chunk_t, chunk)
+		result |= chunk->undoable;
+	return result;
 }
 
 b32 transaction_system_can_redo(void)
@@ -422,6 +580,261 @@ const event_contract_t event_redo__contract = {
 	.save    = (void (*)(const void *, void *))event_undo_redo__save,
 };
 
+/* Spilled files only live as long as the process, so metadata pointers can be
+ * written as-is. */
+typedef struct transaction__spilled_event {
+	const event_metadata_t *meta;
+	s64 time_since_epoch_ms;
+	u32 kind;
+	s32 status;
+	u32 num_children;
+	char nav_description[NAV_DESCRIPTION_SIZE];
+} transaction__spilled_event_t;
+
+static
+b32 transaction__is_undo_redo(const event_t *event)
+{
+	return event->meta->contract == &event_undo__contract
+	    || event->meta->contract == &event_redo__contract;
+}
+
+static
+b32 transaction__event_spillable(const event_t *event)
+{
+	const event_contract_t *contract = event->meta->contract;
+	/* instances with dynamic data can't be written as plain bytes */
+	if (   !transaction__is_undo_redo(event)
+	    && (contract->create || contract->destroy)
+	    && !(contract->save && contract->load))
+		return false;
+	array_foreach(event->children, event_t *, child_ptr)
+		if (!transaction__event_spillable(*child_ptr))
+			return false;
+	return true;
+}
+
+static
+b32 transaction__write_event(const event_t *event, FILE *fp, void *serializer)
+{
+	const event_contract_t *contract = event->meta->contract;
+	transaction__spilled_event_t header = {
+		.meta                = event->meta,
+		.time_since_epoch_ms = event->time_since_epoch_ms,
+		.kind                = event->kind,
+		.status              = event->status,
+		.num_children        = array_sz(event->children),
+	};
+	strbcpy(header.nav_description, event->nav_description);
+
+	if (fwrite(&header, sizeof(header), 1, fp) != 1)
+		return false;
+
+	if (transaction__is_undo_redo(event)) {
+		const event_undo_redo_t *undo_redo = (const event_undo_redo_t *)event->instance;
+		const u32 len = (u32)strlen(undo_redo->label);
+		if (   fwrite(&len, sizeof(len), 1, fp) != 1
+		    || fwrite(undo_redo->label, 1, len, fp) != len)
+			return false;
+	} else if (contract->save) {
+		contract->save(event->instance, serializer);
+	} else if (fwrite(event->instance, event->meta->size, 1, fp) != 1) {
+		return false;
+	}
+
+	array_foreach(event->children, event_t *, child_ptr)
+		if (!transaction__write_event(*child_ptr, fp, serializer))
+			return false;
+	return true;
+}
+
+static
+event_t *transaction__read_event(transaction_system_t *sys, FILE *fp, void *serializer)
+{
+	transaction__spilled_event_t header;
+	const event_contract_t *contract;
+	event_t *event;
+
+	if (fread(&header, sizeof(header), 1, fp) != 1)
+		return NULL;
+
+	event = event_create_empty(header.kind, header.meta, header.nav_description, sys->alc);
+	event->time_since_epoch_ms = header.time_since_epoch_ms;
+	event->status = header.status;
+	contract = event->meta->contract;
+
+	if (transaction__is_undo_redo(event)) {
+		event_undo_redo_t *undo_redo = (event_undo_redo_t *)event->instance;
+		u32 len;
+		event_undo_redo__create(undo_redo, sys->alc);
+		if (fread(&len, sizeof(len), 1, fp) != 1)
+			goto err;
+		array_set_sz(undo_redo->label, len + 1);
+		undo_redo->label[len] = 0;
+		if (fread(undo_redo->label, 1, len, fp) != len)
+			goto err;
+	} else if (contract->load) {
+		if (!contract->load(event->instance, serializer))
+			goto err;
+	} else if (fread(event->instance, event->meta->size, 1, fp) != 1) {
+		goto err;
+	}
+
+	for (u32 i = 0; i < header.num_children; ++i) {
+		event_t *child = transaction__read_event(sys, fp, serializer);
+		if (!child)
+			goto err;
+		array_append(event->children, child);
+	}
+	return event;
+
+err:
+	event_destroy(event, sys->alc);
+	return NULL;
+}
+
+static
+void *transaction__serializer_create(transaction_system_t *sys)
+{
+	return sys->budget.serializer_create
+	     ? sys->budget.serializer_create(sys->spill_fp, sys->budget.userp)
+	     : sys->spill_fp;
+}
+
+static
+void transaction__serializer_destroy(transaction_system_t *sys, void *serializer)
+{
+	if (sys->budget.serializer_destroy)
+		sys->budget.serializer_destroy(serializer, sys->budget.userp);
+}
+
+static
+b32 transaction__open_spill(transaction_system_t *sys)
+{
+	char fname[UUID_BUF_SZ];
+
+	if (sys->spill_fp)
+		return true;
+
+	if (!mkpath(imcachedir())) {
+		log_error("failed to create cache directory for undo history");
+		return false;
+	}
+
+	uuid_to_str(uuid_create(), fname);
+	str_cpy(&sys->spill_path, impathcatprintf(imcachedir(), "undo_%s.bin", fname));
+	sys->spill_fp = file_open(sys->spill_path, "w+b");
+	if (!sys->spill_fp) {
+		log_error("failed to open undo history file '%s'", sys->spill_path);
+		return false;
+	}
+	return true;
+}
+
+/* Spilled chunks must never need to be redone: spilling stops at undone root
+ * events, and undone secondary events are only spilled along with a later event
+ * that stops event_redo__execute from walking back into them. */
+static
+void transaction__spill(transaction_system_t *sys)
+{
+	const u32 max_events = sys->budget.max_events;
+	transaction_spill_chunk_t chunk = {0};
+	void *serializer;
+	b32 pending = false;
+	u32 n = 0;
+
+	if (max_events == 0 || array_sz(sys->event_history) <= max_events)
+		return;
+
+	/* spill down to half the budget so spills don't happen on every event,
+	 * but keep the last event around for merging */
+	for (u32 i = 0, end = array_sz(sys->event_history) - max(max_events / 2, 1); i < end; ++i) {
+		const event_t *event = sys->event_history[i];
+		if (   (!event->meta->secondary && event->status == EVENT_STATUS_UNDONE)
+		    || !transaction__event_spillable(event))
+			break;
+		if (event->status == EVENT_STATUS_UNDONE)
+			pending = true;
+		else if (event->status != EVENT_STATUS_UNREACHABLE)
+			pending = false;
+		if (!pending)
+			n = i + 1;
+	}
+	if (n == 0 || !transaction__open_spill(sys))
+		return;
+
+	/* overwrite any chunks which were paged back in */
+	if (!array_empty(sys->spilled))
+		chunk.offset = array_last(sys->spilled).offset + array_last(sys->spilled).size;
+	if (fseek(sys->spill_fp, chunk.offset, SEEK_SET) != 0)
+		return;
+
+	serializer = transaction__serializer_create(sys);
+	for (u32 i = 0; i < n; ++i) {
+		const event_t *event = sys->event_history[i];
+		if (!transaction__write_event(event, sys->spill_fp, serializer)) {
+			log_error("failed to write undo history file '%s'", sys->spill_path);
+			transaction__serializer_destroy(sys, serializer);
+			return;
+		}
+		chunk.undoable |= !event->meta->secondary
+		               && event->status == EVENT_STATUS_DONE
+		               && event->kind > EVENT_KIND_REDO;
+	}
+	transaction__serializer_destroy(sys, serializer);
+	if (fflush(sys->spill_fp) != 0 || (chunk.size = ftell(sys->spill_fp) - chunk.offset) <= 0) {
+		log_error("failed to write undo history file '%s'", sys->spill_path);
+		return;
+	}
+
+	chunk.num_events = n;
+	array_append(sys->spilled, chunk);
+	for (u32 i = 0; i < n; ++i)
+		event_destroy(sys->event_history[i], sys->alc);
+	array_remove_range(sys->event_history, 0, n);
+}
+
+static
+b32 transaction__page_in(transaction_system_t *sys)
+{
+	transaction_spill_chunk_t chunk;
+	array(event_t *) events;
+	void *serializer;
+	b32 success = true;
+
+	if (array_empty(sys->spilled))
+		return false;
+
+	chunk = array_last(sys->spilled);
+	array_pop(sys->spilled);
+	if (fseek(sys->spill_fp, chunk.offset, SEEK_SET) != 0) {
+		log_error("failed to read undo history file '%s'", sys->spill_path);
+		return false;
+	}
+
+	array_init_ex(events, chunk.num_events, sys->alc);
+	serializer = transaction__serializer_create(sys);
+	for (u32 i = 0; i < chunk.num_events && success; ++i) {
+		event_t *event = transaction__read_event(sys, sys->spill_fp, serializer);
+		if (event)
+			array_append(events, event);
+		else
+			success = false;
+	}
+	transaction__serializer_destroy(sys, serializer);
+
+	if (success) {
+		array_insert_n(sys->event_history, 0, events, chunk.num_events);
+	} else {
+		/* the older history is unreachable without this chunk */
+		log_error("failed to read undo history file '%s'", sys->spill_path);
+		array_foreach(events, event_t *, event_ptr)
+			event_destroy(*event_ptr, sys->alc);
+		array_clear(sys->spilled);
+	}
+	array_destroy(events);
+	return success;
+}
+
 void transaction_spawn_store(const store_metadata_t *meta, u32 kind)
 {
 	transaction_system_t *sys = g_active_transaction_system;
@@ -438,7 +851,14 @@ void transaction_spawn_store(const store_metadata_t *meta, u32 kind)
 void *transaction_spawn_event(const event_metadata_t *meta, const char *nav_description, u32 kind)
 {
 	transaction_system_t *sys = g_active_transaction_system;
-	event_t *event = event_create(kind, meta, nav_description, sys->alc);
+	event_t *event;
+	if (meta->contract->create || meta->contract->destroy) {
+		event = event_create(kind, meta, nav_description, sys->alc);
+	} else {
+		event = event_create(kind, meta, nav_description, &sys->arena->alc);
+		event->from_arena = true;
+		sys->arena->pending++;
+	}
 	return event->instance;
 }
 
@@ -460,7 +880,7 @@ u32 transaction__handle_priority_event(transaction_system_t *sys, event_t *event
 		/* Priority events should be never accessible to other undos/redos */
 		event->status = EVENT_STATUS_UNREACHABLE;
 		/* Priority events are never secondary, nor are they ever nested */
-		array_append(sys->event_history, event);
+		array_append(sys->event_history, transaction__promote_event(sys, event));
 		if (sys->logger)
 			sys->logger->log(sys->logger->userp, array_sz(sys->event_history) - 1);
 		result = event->kind;
@@ -478,7 +898,9 @@ u32 transaction__handle_child_event(transaction_system_t *sys, event_t *event, e
 	sys->active_parent = event;
 
 	if (event_execute(event)) {
-		array_append(parent->children, event);
+		/* arena children are promoted along with their parent */
+		array_append(parent->children,
+		             parent->from_arena ? event : transaction__promote_event(sys, event));
 		result = event->kind;
 	} else {
 		event_unwind_children(event, sys->alc);
@@ -570,7 +992,7 @@ u32 transaction__handle_ordinary_event(transaction_system_t *sys, event_t *event
 				event_destroy(event, sys->alc);
 			} else {
 				/* Handle fresh secondary event */
-				array_append(sys->temp_secondary_events, event);
+				array_append(sys->temp_secondary_events, transaction__promote_event(sys, event));
 				result = event->kind;
 			}
 		} else {
@@ -587,11 +1009,12 @@ u32 transaction__handle_ordinary_event(transaction_system_t *sys, event_t *event
 				const u32 start = array_sz(sys->event_history);
 				transaction__mark_unreachables(sys);
 				transaction__push_temp_events(sys);
-				array_append(sys->event_history, event);
+				array_append(sys->event_history, transaction__promote_event(sys, event));
 				if (sys->logger)
 					for (u32 i = start; i < array_sz(sys->event_history); ++i)
 						sys->logger->log(sys->logger->userp, i);
 				result = event->kind;
+				transaction__spill(sys);
 			}
 		}
 	} else {
@@ -608,20 +1031,27 @@ u32 transaction__handle_ordinary_event(transaction_system_t *sys, event_t *event
 u32 transaction__flush(event_t *event)
 {
 	transaction_system_t *sys = g_active_transaction_system;
+	const b32 from_arena = event->from_arena;
+	u32 result;
 
 	if (sys->undoing) {
 		/* While undoing, prevent nested events from executing, since they should have already
 		 * been handled by explicit calls to their undo handlers. */
 		event_destroy(event, sys->alc);
-		return EVENT_KIND_NOOP;
+		result = EVENT_KIND_NOOP;
+	} else if (event->kind < 3) {
+		result = transaction__handle_priority_event(sys, event);
+	} else if (sys->active_parent) {
+		result = transaction__handle_child_event(sys, event, sys->active_parent);
+	} else {
+		result = transaction__handle_ordinary_event(sys, event);
 	}
 
-	if (event->kind < 3)
-		return transaction__handle_priority_event(sys, event);
-	else if (sys->active_parent)
-		return transaction__handle_child_event(sys, event, sys->active_parent);
-	else
-		return transaction__handle_ordinary_event(sys, event);
+	/* the event was either promoted or destroyed, but nested events may still
+	 * be pending in an outer flush */
+	if (from_arena && --sys->arena->pending == 0)
+		transaction__arena_reset(sys->arena);
+	return result;
 }
 
 transaction_system_t *get_active_transaction_system(void)
@@ -2,8 +2,8 @@
 
 #include "GL/glew.h"
 
-#define GUI_MAX_VERTS 16384
-#define GUI_MAX_DRAW_CALLS 4096
+#define GUI_VERT_CHUNK_SZ 16384
+#define GUI_DRAW_CALL_CHUNK_SZ 4096
 #define GUI_MAX_SCISSORS 32
 #define GUI_USE_CURSOR_BUTTON
 
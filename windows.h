@@ -505,6 +505,40 @@ out:
 	return bytes;
 }
 
+const void *file_map(const char *fname, size_t *sz)
+{
+	wchar_t fname_w[PATH_MAX];
+	HANDLE file, mapping;
+	LARGE_INTEGER file_size;
+	const void *data = NULL;
+	if (!os_string_from_utf8(B2PS(fname_w), fname)) {
+		log_error("%s(%s): os_string_from_utf8(%s) error %d",
+		          __FUNCTION__, fname, fname, GetLastError());
+		return NULL;
+	}
+	file = CreateFileW(fname_w, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+	                   FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return NULL;
+	if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+		/* the view keeps the mapping alive after the handles are closed */
+		mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping) {
+			data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(file);
+	if (data)
+		*sz = (size_t)file_size.QuadPart;
+	return data;
+}
+
+void file_unmap(const void *data, size_t sz)
+{
+	UnmapViewOfFile(data);
+}
+
 /* Dynamic library */
 
 #ifndef VIOLET_NO_LIB